@@ -0,0 +1,174 @@
+#include "AnimationClip.h"
+
+#include <algorithm>
+#include <cmath>
+
+static constexpr float component_limit = 0.70710678f; // 1 / sqrt(2), no component but the largest can exceed it
+static constexpr float component_steps = 32767.0f;
+static constexpr float component_scale = 2.0f * component_limit / component_steps;
+
+void poseToLocals(const JointPose* poses, size_t count, glm::mat4* locals)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const glm::quat& q = poses[i].rotation;
+        const glm::vec3& s = poses[i].scale;
+
+        const float xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+        const float xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+        const float wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+        glm::mat4& local = locals[i];
+        local[0] = glm::vec4(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy), 0.0f) * s.x;
+        local[1] = glm::vec4(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx), 0.0f) * s.y;
+        local[2] = glm::vec4(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy), 0.0f) * s.z;
+        local[3] = glm::vec4(poses[i].translation, 1.0f);
+    }
+}
+
+glm::quat nlerp(const glm::quat& a, const glm::quat& b, float t)
+{
+    const float d = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    const float tb = d < 0.0f ? -t : t;
+    const float ta = 1.0f - t;
+
+    const float x = a.x * ta + b.x * tb;
+    const float y = a.y * ta + b.y * tb;
+    const float z = a.z * ta + b.z * tb;
+    const float w = a.w * ta + b.w * tb;
+    const float inverse_length = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+
+    return glm::quat(w * inverse_length, x * inverse_length, y * inverse_length, z * inverse_length);
+}
+
+void blendPoses(const JointPose* a, const JointPose* b, size_t count, float weight, JointPose* out)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        out[i].rotation = nlerp(a[i].rotation, b[i].rotation, weight);
+        out[i].translation = glm::mix(a[i].translation, b[i].translation, weight);
+        out[i].scale = glm::mix(a[i].scale, b[i].scale, weight);
+    }
+}
+
+PackedRotation packRotation(const glm::quat& rotation)
+{
+    float q[4] = { rotation.x, rotation.y, rotation.z, rotation.w };
+
+    uint32_t largest = 0;
+    for (uint32_t i = 1; i < 4; ++i)
+    {
+        if (std::abs(q[i]) > std::abs(q[largest]))
+            largest = i;
+    }
+
+    const float sign = q[largest] < 0.0f ? -1.0f : 1.0f;
+    const float length = std::sqrt(q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3]);
+
+    PackedRotation packed{};
+    for (uint32_t i = 0, c = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+
+        const float component = std::clamp(q[i] * sign / length, -component_limit, component_limit);
+        packed.components[c++] = static_cast<uint16_t>(std::lround((component / component_limit * 0.5f + 0.5f) * component_steps));
+    }
+    packed.components[0] |= static_cast<uint16_t>((largest >> 1) << 15);
+    packed.components[1] |= static_cast<uint16_t>((largest & 1) << 15);
+
+    return packed;
+}
+
+glm::quat unpackRotation(const PackedRotation& packed)
+{
+    const uint32_t largest = ((packed.components[0] >> 15) << 1) | (packed.components[1] >> 15);
+
+    float q[4];
+    float sum = 0.0f;
+    for (uint32_t i = 0, c = 0; i < 4; ++i)
+    {
+        if (i == largest)
+            continue;
+
+        q[i] = (packed.components[c++] & 0x7FFF) * component_scale - component_limit;
+        sum += q[i] * q[i];
+    }
+    q[largest] = std::sqrt(std::max(0.0f, 1.0f - sum));
+
+    return glm::quat(q[3], q[0], q[1], q[2]);
+}
+
+glm::vec3 unpackVector(const PackedVector& packed, const AnimationTrack& track)
+{
+    return track.range_min + track.range_extent * glm::vec3(packed.components[0], packed.components[1], packed.components[2]) * (1.0f / 65535.0f);
+}
+
+void AnimationClip::resetCursor(ClipCursor& cursor) const
+{
+    cursor.clip = this;
+    cursor.keys.assign(size_t(joint_count) * channel_count, 0);
+    cursor.last_time = 0.0f;
+}
+
+// Advances the track's cached key to the one at or before key_time and returns where between it and the next key
+// key_time lies. a and b are the keys to interpolate, equal for constant tracks and past the last key
+static float findKeys(const AnimationTrack& track, const uint16_t* channel_times, float key_time, uint32_t& cached_key, uint32_t& a, uint32_t& b)
+{
+    const uint16_t* track_times = channel_times + track.first_key;
+
+    uint32_t key = cached_key;
+    while (key + 1 < track.key_count && track_times[key + 1] <= key_time)
+        ++key;
+    cached_key = key;
+
+    a = track.first_key + key;
+    if (key + 1 >= track.key_count)
+    {
+        b = a;
+        return 0.0f;
+    }
+
+    b = a + 1;
+    const float t = (key_time - track_times[key]) / static_cast<float>(track_times[key + 1] - track_times[key]);
+    return std::clamp(t, 0.0f, 1.0f);
+}
+
+void AnimationClip::sample(float time, ClipCursor& cursor, JointPose* poses) const
+{
+    time = std::clamp(time, 0.0f, duration);
+
+    // switching clips, looping or seeking back restarts every track, moving forward continues from the cached keys
+    if (cursor.clip != this || time < cursor.last_time)
+        resetCursor(cursor);
+    cursor.last_time = time;
+
+    const float key_time = duration > 0.0f ? time * (65535.0f / duration) : 0.0f;
+    uint32_t* rotation_keys = cursor.keys.data();
+    uint32_t* translation_keys = rotation_keys + joint_count;
+    uint32_t* scale_keys = translation_keys + joint_count;
+
+    // a loop per channel keeps each one branch free and its keys in cache, constant tracks skip interpolating
+    for (uint32_t joint = 0; joint < joint_count; ++joint)
+    {
+        uint32_t a, b;
+        const float t = findKeys(tracks[Rotation][joint], times[Rotation].data(), key_time, rotation_keys[joint], a, b);
+        poses[joint].rotation = a == b ? unpackRotation(rotations[a]) : nlerp(unpackRotation(rotations[a]), unpackRotation(rotations[b]), t);
+    }
+
+    for (uint32_t joint = 0; joint < joint_count; ++joint)
+    {
+        const AnimationTrack& track = tracks[Translation][joint];
+        uint32_t a, b;
+        const float t = findKeys(track, times[Translation].data(), key_time, translation_keys[joint], a, b);
+        poses[joint].translation = a == b ? unpackVector(translations[a], track) : glm::mix(unpackVector(translations[a], track), unpackVector(translations[b], track), t);
+    }
+
+    for (uint32_t joint = 0; joint < joint_count; ++joint)
+    {
+        const AnimationTrack& track = tracks[Scale][joint];
+        uint32_t a, b;
+        const float t = findKeys(track, times[Scale].data(), key_time, scale_keys[joint], a, b);
+        poses[joint].scale = a == b ? unpackVector(scales[a], track) : glm::mix(unpackVector(scales[a], track), unpackVector(scales[b], track), t);
+    }
+}
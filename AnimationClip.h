@@ -0,0 +1,95 @@
+#pragma once
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// A joint's transform relative to its parent, split up so poses can be sampled and blended component wise
+struct JointPose
+{
+    glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 translation = glm::vec3(0.0f);
+    glm::vec3 scale = glm::vec3(1.0f);
+};
+
+// the matrices Skeleton::localToModel expects, translation * rotation * scale
+void poseToLocals(const JointPose* poses, size_t count, glm::mat4* locals);
+
+// normalised lerp along the shorter arc. Sampling interpolates keys with it, so the cooker checks dropped keys
+// against exactly this
+glm::quat nlerp(const glm::quat& a, const glm::quat& b, float t);
+
+// out = a blended towards b by weight, rotations along the shorter arc. out may alias a or b
+void blendPoses(const JointPose* a, const JointPose* b, size_t count, float weight, JointPose* out);
+
+// Unit quaternion in 48 bits: the largest component is dropped (and made positive, q and -q are the same rotation),
+// the other three are stored in 15 bits each over [-1/sqrt(2), 1/sqrt(2)], which is all they can span. The dropped
+// component's index goes in the top bits of the first two
+struct PackedRotation
+{
+    uint16_t components[3];
+};
+
+PackedRotation packRotation(const glm::quat& rotation);
+glm::quat unpackRotation(const PackedRotation& packed);
+
+// a translation or scale key in 16 bits per axis, relative to its track's range
+struct PackedVector
+{
+    uint16_t components[3];
+};
+
+// Keys of one joint channel: key_count entries from first_key on in the channel's time and value arrays.
+// Vector tracks also carry the range their keys are quantised over
+struct AnimationTrack
+{
+    uint32_t first_key;
+    uint32_t key_count; // at least 1, a single key holds the channel constant
+    glm::vec3 range_min = glm::vec3(0.0f);
+    glm::vec3 range_extent = glm::vec3(0.0f);
+};
+
+// Where each track of an instance's clip was sampled last, so sampling the next frame starts from there and
+// usually finds its keys without searching
+struct ClipCursor
+{
+    const struct AnimationClip* clip = nullptr; // the keys are only valid for the clip they were found in
+    std::vector<uint32_t> keys; // per track, relative to its first_key
+    float last_time = 0.0f;
+};
+
+// A skeletal animation converted from assimp's per node key arrays into structure of arrays: every channel of
+// every joint is a track into shared, compressed key arrays, so sampling walks a few small contiguous arrays instead
+// of chasing per node allocations. Key times are unorm16 over the clip's duration. Keys that linear interpolation
+// of their neighbours reproduces within tolerance are removed when cooking, see AnimationCooker.
+// Every joint of the skeleton has all three tracks, joints the source didn't animate hold their bind pose
+struct AnimationClip
+{
+    enum Channel
+    {
+        Rotation,
+        Translation,
+        Scale,
+        channel_count
+    };
+
+    std::string name;
+    float duration = 0.0f; // seconds
+    uint32_t joint_count = 0;
+
+    std::vector<AnimationTrack> tracks[channel_count]; // joint_count each
+    std::vector<uint16_t> times[channel_count];
+    std::vector<PackedRotation> rotations;
+    std::vector<PackedVector> translations;
+    std::vector<PackedVector> scales;
+
+    void resetCursor(ClipCursor& cursor) const;
+
+    // time is clamped to [0, duration], poses holds joint_count entries. A cursor last used with another clip is reset
+    void sample(float time, ClipCursor& cursor, JointPose* poses) const;
+};
+
+glm::vec3 unpackVector(const PackedVector& packed, const AnimationTrack& track);
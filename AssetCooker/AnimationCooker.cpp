@@ -0,0 +1,276 @@
+#include "AnimationCooker.h"
+
+#include "VulkanWrapper/Log.h"
+
+#include "assimp/scene.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <unordered_map>
+
+namespace
+{
+    // one channel of one joint as the source has it, times in seconds
+    template<typename T>
+    struct SourceTrack
+    {
+        std::vector<float> times;
+        std::vector<T> values;
+    };
+
+    // angle of the rotation between a and b. acos of their dot product loses most of its precision right where the
+    // tolerances are, the half angle from the chord lengths doesn't
+    float rotationError(const glm::quat& a, const glm::quat& b)
+    {
+        const float sign = a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w < 0.0f ? -1.0f : 1.0f;
+        const float dx = a.x - b.x * sign, dy = a.y - b.y * sign, dz = a.z - b.z * sign, dw = a.w - b.w * sign;
+        const float sx = a.x + b.x * sign, sy = a.y + b.y * sign, sz = a.z + b.z * sign, sw = a.w + b.w * sign;
+        return 4.0f * std::atan2(std::sqrt(dx * dx + dy * dy + dz * dz + dw * dw), std::sqrt(sx * sx + sy * sy + sz * sz + sw * sw));
+    }
+
+    float vectorError(const glm::vec3& a, const glm::vec3& b)
+    {
+        return std::max({ std::abs(a.x - b.x), std::abs(a.y - b.y), std::abs(a.z - b.z) });
+    }
+
+    // unorm16 over the clip, keys landing on the same time keep the last one
+    template<typename T>
+    void quantizeTimes(const SourceTrack<T>& source, float duration, std::vector<uint16_t>& times, std::vector<T>& values)
+    {
+        for (size_t i = 0; i < source.times.size(); ++i)
+        {
+            const float normalized = duration > 0.0f ? std::clamp(source.times[i] / duration, 0.0f, 1.0f) : 0.0f;
+            const uint16_t time = static_cast<uint16_t>(std::lround(normalized * 65535.0f));
+
+            if (!times.empty() && times.back() >= time)
+            {
+                values.back() = source.values[i];
+                continue;
+            }
+            times.push_back(time);
+            values.push_back(source.values[i]);
+        }
+    }
+
+    // Greedy reduction: a key is dropped while interpolating from the last kept key to the key after it reproduces
+    // every key in between. within_tolerance(a, b, k, t) checks key k against keys a and b interpolated at t
+    template<typename WithinTolerance>
+    std::vector<uint32_t> reduceKeys(const std::vector<uint16_t>& times, const WithinTolerance& within_tolerance)
+    {
+        const uint32_t count = static_cast<uint32_t>(times.size());
+
+        // constant tracks collapse to their first key
+        bool constant = true;
+        for (uint32_t k = 1; k < count && constant; ++k)
+            constant = within_tolerance(0, 0, k, 0.0f);
+        if (constant)
+            return { 0 };
+
+        std::vector<uint32_t> kept = { 0 };
+        uint32_t anchor = 0;
+        for (uint32_t candidate = 1; candidate + 1 < count; ++candidate)
+        {
+            const uint32_t end = candidate + 1;
+            const float span = static_cast<float>(times[end] - times[anchor]);
+
+            bool removable = true;
+            for (uint32_t k = anchor + 1; k < end && removable; ++k)
+                removable = within_tolerance(anchor, end, k, (times[k] - times[anchor]) / span);
+
+            if (!removable)
+            {
+                kept.push_back(candidate);
+                anchor = candidate;
+            }
+        }
+        kept.push_back(count - 1);
+
+        return kept;
+    }
+
+    void addRotationTrack(const SourceTrack<glm::quat>& source, float tolerance, AnimationClip& clip)
+    {
+        std::vector<uint16_t> times;
+        std::vector<glm::quat> values;
+        quantizeTimes(source, clip.duration, times, values);
+
+        std::vector<PackedRotation> packed(values.size());
+        std::vector<glm::quat> decoded(values.size());
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            packed[i] = packRotation(values[i]);
+            decoded[i] = unpackRotation(packed[i]);
+        }
+
+        const auto kept = reduceKeys(times, [&](uint32_t a, uint32_t b, uint32_t k, float t)
+        {
+            return rotationError(nlerp(decoded[a], decoded[b], t), decoded[k]) <= tolerance;
+        });
+
+        AnimationTrack track{};
+        track.first_key = static_cast<uint32_t>(clip.rotations.size());
+        track.key_count = static_cast<uint32_t>(kept.size());
+        for (uint32_t k : kept)
+        {
+            clip.times[AnimationClip::Rotation].push_back(times[k]);
+            clip.rotations.push_back(packed[k]);
+        }
+        clip.tracks[AnimationClip::Rotation].push_back(track);
+    }
+
+    void addVectorTrack(AnimationClip::Channel channel, const SourceTrack<glm::vec3>& source, float tolerance, AnimationClip& clip)
+    {
+        std::vector<uint16_t> times;
+        std::vector<glm::vec3> values;
+        quantizeTimes(source, clip.duration, times, values);
+
+        AnimationTrack track{};
+        glm::vec3 range_max = values[0];
+        track.range_min = values[0];
+        for (const auto& value : values)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                track.range_min[axis] = std::min(track.range_min[axis], value[axis]);
+                range_max[axis] = std::max(range_max[axis], value[axis]);
+            }
+        }
+        track.range_extent = range_max - track.range_min;
+
+        std::vector<PackedVector> packed(values.size());
+        std::vector<glm::vec3> decoded(values.size());
+        for (size_t i = 0; i < values.size(); ++i)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+            {
+                const float extent = track.range_extent[axis];
+                const float normalized = extent > 0.0f ? (values[i][axis] - track.range_min[axis]) / extent : 0.0f;
+                packed[i].components[axis] = static_cast<uint16_t>(std::lround(std::clamp(normalized, 0.0f, 1.0f) * 65535.0f));
+            }
+            decoded[i] = unpackVector(packed[i], track);
+        }
+
+        const auto kept = reduceKeys(times, [&](uint32_t a, uint32_t b, uint32_t k, float t)
+        {
+            return vectorError(glm::mix(decoded[a], decoded[b], t), decoded[k]) <= tolerance;
+        });
+
+        std::vector<PackedVector>& keys = channel == AnimationClip::Translation ? clip.translations : clip.scales;
+        track.first_key = static_cast<uint32_t>(keys.size());
+        track.key_count = static_cast<uint32_t>(kept.size());
+        for (uint32_t k : kept)
+        {
+            clip.times[channel].push_back(times[k]);
+            keys.push_back(packed[k]);
+        }
+        clip.tracks[channel].push_back(track);
+    }
+
+    void addKeys(SourceTrack<glm::vec3>& track, float seconds_per_tick, const aiVectorKey* keys, unsigned int count)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            track.times.push_back(static_cast<float>(keys[i].mTime * seconds_per_tick));
+            track.values.push_back(glm::vec3(keys[i].mValue.x, keys[i].mValue.y, keys[i].mValue.z));
+        }
+    }
+}
+
+std::vector<AnimationClip> cookAnimations(const std::string& source_path, const aiScene* scene, const Skeleton& skeleton, const AnimationCookSettings& settings)
+{
+    std::vector<AnimationClip> clips;
+    if (skeleton.empty())
+        return clips;
+
+    // joints the source doesn't animate are held in their bind pose
+    std::vector<JointPose> bind_pose(skeleton.jointCount());
+    for (uint32_t j = 0; j < skeleton.jointCount(); ++j)
+    {
+        const aiNode* node = scene->mRootNode->FindNode(skeleton.names[j].c_str());
+        if (!node)
+            continue;
+
+        aiVector3D scaling, position;
+        aiQuaternion rotation;
+        node->mTransformation.Decompose(scaling, rotation, position);
+        bind_pose[j].rotation = glm::quat(rotation.w, rotation.x, rotation.y, rotation.z);
+        bind_pose[j].translation = glm::vec3(position.x, position.y, position.z);
+        bind_pose[j].scale = glm::vec3(scaling.x, scaling.y, scaling.z);
+    }
+
+    std::unordered_map<std::string, uint32_t> joint_indices;
+    for (uint32_t j = 0; j < skeleton.jointCount(); ++j)
+        joint_indices.emplace(skeleton.names[j], j);
+
+    for (unsigned int a = 0; a < scene->mNumAnimations; ++a)
+    {
+        const aiAnimation* animation = scene->mAnimations[a];
+        const double ticks_per_second = animation->mTicksPerSecond > 0.0 ? animation->mTicksPerSecond : 25.0;
+        const float seconds_per_tick = static_cast<float>(1.0 / ticks_per_second);
+
+        std::vector<const aiNodeAnim*> channels(skeleton.jointCount(), nullptr);
+        uint32_t dropped_channels = 0;
+        size_t source_keys = 0;
+        for (unsigned int c = 0; c < animation->mNumChannels; ++c)
+        {
+            const aiNodeAnim* channel = animation->mChannels[c];
+            auto joint = joint_indices.find(channel->mNodeName.C_Str());
+            if (joint == joint_indices.end())
+            {
+                ++dropped_channels;
+                continue;
+            }
+
+            channels[joint->second] = channel;
+            source_keys += channel->mNumRotationKeys + channel->mNumPositionKeys + channel->mNumScalingKeys;
+        }
+
+        if (dropped_channels)
+            log_warning((source_path + ": " + std::to_string(dropped_channels) + " channels of animation " + animation->mName.C_Str() + " animate nodes outside the skeleton\n").c_str());
+
+        AnimationClip& clip = clips.emplace_back();
+        clip.name = animation->mName.C_Str();
+        clip.duration = static_cast<float>(animation->mDuration * seconds_per_tick);
+        clip.joint_count = skeleton.jointCount();
+
+        for (uint32_t j = 0; j < skeleton.jointCount(); ++j)
+        {
+            const aiNodeAnim* channel = channels[j];
+
+            SourceTrack<glm::quat> rotation;
+            SourceTrack<glm::vec3> translation, scale;
+            if (channel)
+            {
+                for (unsigned int k = 0; k < channel->mNumRotationKeys; ++k)
+                {
+                    const aiQuaternion& q = channel->mRotationKeys[k].mValue;
+                    rotation.times.push_back(static_cast<float>(channel->mRotationKeys[k].mTime * seconds_per_tick));
+                    rotation.values.push_back(glm::quat(q.w, q.x, q.y, q.z));
+                }
+                addKeys(translation, seconds_per_tick, channel->mPositionKeys, channel->mNumPositionKeys);
+                addKeys(scale, seconds_per_tick, channel->mScalingKeys, channel->mNumScalingKeys);
+            }
+
+            if (rotation.times.empty())
+                rotation = { { 0.0f }, { bind_pose[j].rotation } };
+            if (translation.times.empty())
+                translation = { { 0.0f }, { bind_pose[j].translation } };
+            if (scale.times.empty())
+                scale = { { 0.0f }, { bind_pose[j].scale } };
+
+            addRotationTrack(rotation, settings.rotation_tolerance, clip);
+            addVectorTrack(AnimationClip::Translation, translation, settings.translation_tolerance, clip);
+            addVectorTrack(AnimationClip::Scale, scale, settings.scale_tolerance, clip);
+        }
+
+        if (settings.print_stats)
+        {
+            const size_t cooked_keys = clip.rotations.size() + clip.translations.size() + clip.scales.size();
+            const size_t cooked_bytes = cooked_keys * (sizeof(uint16_t) + sizeof(PackedVector)) + size_t(clip.joint_count) * AnimationClip::channel_count * sizeof(AnimationTrack);
+            printf("%s: animation %s, %.2fs, %zu keys -> %zu (%zu bytes)\n", source_path.c_str(), clip.name.c_str(), clip.duration, source_keys, cooked_keys, cooked_bytes);
+        }
+    }
+
+    return clips;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "AnimationClip.h"
+#include "Skeleton.h"
+
+#include <string>
+#include <vector>
+
+struct aiScene;
+
+// how far the cooked clips may drift from the source keys before a key has to be kept
+struct AnimationCookSettings
+{
+    float rotation_tolerance = 0.001f; // radians
+    float translation_tolerance = 0.0001f; // model units
+    float scale_tolerance = 0.0001f;
+
+    bool print_stats = false;
+};
+
+// Converts every animation of the scene into an AnimationClip for skeleton. Channels are matched to joints by node
+// name, channels for nodes outside the skeleton are dropped. Keys are quantised first, then each track drops the
+// keys that interpolating the ones kept around them reproduces within tolerance of the quantised values
+std::vector<AnimationClip> cookAnimations(const std::string& source_path, const aiScene* scene, const Skeleton& skeleton, const AnimationCookSettings& settings);
@@ -0,0 +1,161 @@
+#include "Manifest.h"
+#include "MeshCooker.h"
+#include "TextureCooker.h"
+
+#include "AssetFile.h"
+#include "CookedTexture.h"
+#include "MeshCache.h"
+#include "ThreadPool.h"
+#include "Vertex.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// bump whenever cooking changes in a way the output formats' own versions don't capture
+static constexpr uint32_t cooker_version = 1;
+
+enum class AssetType
+{
+    Model,
+    Texture,
+};
+
+struct CookJob
+{
+    AssetType type;
+    std::string source; // relative to the source root, forward slashes
+    uint64_t hash = 0;
+    bool cooked = false;
+    bool failed = false;
+};
+
+static bool assetType(const fs::path& path, AssetType& type)
+{
+    std::string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    if (extension == ".gltf" || extension == ".glb" || extension == ".obj" || extension == ".fbx" || extension == ".dae")
+        type = AssetType::Model;
+    else if (extension == ".png" || extension == ".jpg" || extension == ".jpeg" || extension == ".tga" || extension == ".bmp")
+        type = AssetType::Texture;
+    else
+        return false;
+
+    return true;
+}
+
+// the runtime finds cooked outputs by appending these to the source path under the output root
+static const char* outputExtension(AssetType type)
+{
+    return type == AssetType::Model ? ".mesh" : ".ktx2";
+}
+
+int main(int argc, char** argv)
+{
+    const fs::path source_root = argc > 1 ? argv[1] : "..";
+    const fs::path output_root = argc > 2 ? fs::path(argv[2]) : source_root / "Cooked";
+    const std::string manifest_path = (output_root / "manifest.txt").string();
+
+    std::vector<CookJob> jobs;
+    for (const char* directory : { "Models", "Textures" })
+    {
+        std::error_code error;
+        for (const auto& entry : fs::recursive_directory_iterator(source_root / directory, error))
+        {
+            CookJob job{};
+            if (entry.is_regular_file() && assetType(entry.path(), job.type))
+            {
+                job.source = fs::relative(entry.path(), source_root).generic_string();
+                jobs.push_back(job);
+            }
+        }
+    }
+
+    std::sort(jobs.begin(), jobs.end(), [](const CookJob& a, const CookJob& b) { return a.source < b.source; });
+
+    CookManifest manifest;
+    if (!manifest.load(manifest_path, cooker_version))
+        printf("no manifest for cooker version %u, cooking everything\n", cooker_version);
+
+    MeshOptimizeSettings optimize_settings{};
+    optimize_settings.print_stats = true;
+
+    ThreadPool thread_pool;
+    thread_pool.init();
+
+    // every asset is hashed and, if it changed, cooked on the pool
+    thread_pool.parallelFor(jobs.size(), [&](size_t i, uint32_t thread_index)
+    {
+        CookJob& job = jobs[i];
+        const std::string source_path = (source_root / job.source).string();
+        const fs::path output_path = output_root / (job.source + outputExtension(job.type));
+
+        // the hash also covers the output format, so a format bump recooks just like a changed source
+        const uint32_t format_version = job.type == AssetType::Model ? MeshCache::version : CookedTexture::version;
+        job.hash = hashBytes(&format_version, sizeof(format_version));
+
+        bool hashed;
+        if (job.type == AssetType::Model)
+        {
+            const uint32_t vertex_stride = sizeof(Vertex);
+            job.hash = hashBytes(&vertex_stride, sizeof(vertex_stride), job.hash);
+            hashed = hashModelSource(source_path, job.hash);
+        }
+        else
+            hashed = hashFile(source_path, job.hash);
+
+        if (!hashed)
+        {
+            printf("failed to read %s\n", job.source.c_str());
+            job.failed = true;
+            return;
+        }
+
+        auto entry = manifest.entries.find(job.source);
+        std::error_code error;
+        if (entry != manifest.entries.end() && entry->second == job.hash && fs::exists(output_path, error))
+            return;
+
+        fs::create_directories(output_path.parent_path(), error);
+
+        const bool cooked = job.type == AssetType::Model
+            ? cookModel(source_path, output_path.string(), job.hash, optimize_settings)
+            : cookTexture(source_path, output_path.string());
+
+        job.cooked = cooked;
+        job.failed = !cooked;
+        printf("%s %s\n", cooked ? "cooked" : "FAILED", job.source.c_str());
+    });
+
+    thread_pool.deinit();
+
+    // failed assets keep no entry so they are retried next time, removed sources drop out of the manifest
+    CookManifest updated;
+    updated.cooker_version = cooker_version;
+
+    size_t cooked_count = 0, failed_count = 0;
+    for (const CookJob& job : jobs)
+    {
+        cooked_count += job.cooked;
+        failed_count += job.failed;
+        if (!job.failed)
+            updated.entries[job.source] = job.hash;
+    }
+
+    std::error_code error;
+    fs::create_directories(output_root, error);
+    if (!updated.save(manifest_path))
+    {
+        printf("failed to write %s\n", manifest_path.c_str());
+        return 1;
+    }
+
+    printf("%zu assets: %zu cooked, %zu up to date, %zu failed\n", jobs.size(), cooked_count, jobs.size() - cooked_count - failed_count, failed_count);
+    return failed_count == 0 ? 0 : 1;
+}
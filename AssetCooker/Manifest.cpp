@@ -0,0 +1,57 @@
+#include "Manifest.h"
+
+#include "AssetFile.h"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+bool CookManifest::load(const std::string& path, uint32_t expected_version)
+{
+    cooker_version = expected_version;
+    entries.clear();
+
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    std::string line;
+    uint32_t version = 0;
+    if (!std::getline(file, line) || sscanf(line.c_str(), "asset_cooker %u", &version) != 1 || version != expected_version)
+        return false;
+
+    // <hash> <source path>, the path runs to the end of the line so it may contain spaces
+    while (std::getline(file, line))
+    {
+        uint64_t hash;
+        int path_start = 0;
+        if (sscanf(line.c_str(), "%" SCNx64 " %n", &hash, &path_start) != 1 || path_start == 0)
+            continue;
+
+        entries[line.substr(path_start)] = hash;
+    }
+
+    return true;
+}
+
+bool CookManifest::save(const std::string& path) const
+{
+    // sorted so the manifest diffs cleanly
+    std::vector<std::pair<std::string, uint64_t>> sorted(entries.begin(), entries.end());
+    std::sort(sorted.begin(), sorted.end());
+
+    std::ostringstream contents;
+    contents << "asset_cooker " << cooker_version << "\n";
+    for (const auto& [source, hash] : sorted)
+    {
+        char hash_text[17];
+        snprintf(hash_text, sizeof(hash_text), "%016" PRIx64, hash);
+        contents << hash_text << " " << source << "\n";
+    }
+
+    const std::string text = contents.str();
+    return writeFileAtomic(path, text.data(), text.size());
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+// Content hash every source was last cooked from, keyed by its path relative to the source root.
+// A manifest written by a different cooker version is discarded, so a format change recooks everything
+struct CookManifest
+{
+    uint32_t cooker_version = 0;
+    std::unordered_map<std::string, uint64_t> entries;
+
+    // returns false (and leaves the manifest empty) if the file is missing or from another cooker version
+    bool load(const std::string& path, uint32_t expected_version);
+    bool save(const std::string& path) const;
+};
@@ -0,0 +1,351 @@
+#include "MeshCooker.h"
+#include "AnimationCooker.h"
+
+#include "MeshCache.h"
+#include "Vertex.h"
+#include "VulkanWrapper/Log.h"
+
+#include "assimp/Importer.hpp"
+#include "assimp/postprocess.h"
+#include "assimp/scene.h"
+
+#include "glm/gtc/type_ptr.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// a vertex and its influences, which are welded and reordered together. Static meshes leave the influence zeroed
+struct SkinnedVertex
+{
+	Vertex vert;
+	SkinInfluence influence;
+
+	bool operator==(const SkinnedVertex& other) const
+	{
+		return vert == other.vert && memcmp(&influence, &other.influence, sizeof(SkinInfluence)) == 0;
+	}
+};
+
+// vertices are plain floats and integers without padding, so hashing the bytes is consistent with operator==
+// (apart from -0.0 vs 0.0, which only costs a missed weld)
+struct VertexHash
+{
+	size_t operator()(const SkinnedVertex& vert) const
+	{
+		const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&vert);
+		size_t hash = 14695981039346656037ull;
+		for (size_t i = 0; i < sizeof(SkinnedVertex); ++i)
+			hash = (hash ^ bytes[i]) * 1099511628211ull;
+		return hash;
+	}
+};
+
+static glm::mat4 toGlm(const aiMatrix4x4& matrix)
+{
+	// assimp is row major
+	return glm::transpose(glm::make_mat4(&matrix.a1));
+}
+
+static void addJoints(const aiNode* node, int32_t parent, const glm::mat4& parent_global, const std::unordered_set<const aiNode*>& needed,
+	const std::unordered_map<std::string, aiMatrix4x4>& offsets, Skeleton& skeleton)
+{
+	if (!needed.count(node))
+		return;
+
+	const glm::mat4 local = toGlm(node->mTransformation);
+	const glm::mat4 global = parent_global * local;
+
+	// nodes that only hold bones up have no bind matrix of their own, nothing is bound to them anyway
+	auto offset = offsets.find(node->mName.C_Str());
+	const int32_t index = static_cast<int32_t>(skeleton.parents.size());
+	skeleton.names.push_back(node->mName.C_Str());
+	skeleton.parents.push_back(parent);
+	skeleton.bind_locals.push_back(local);
+	skeleton.inverse_binds.push_back(offset != offsets.end() ? toGlm(offset->second) : glm::inverse(global));
+
+	for (unsigned int i = 0; i < node->mNumChildren; ++i)
+		addJoints(node->mChildren[i], index, global, needed, offsets, skeleton);
+}
+
+// the bones of every mesh and all nodes above them, in one hierarchy for the whole model
+static Skeleton importSkeleton(const std::string& source_path, const aiScene* scene)
+{
+	// inverse bind matrices come from the first mesh that uses each bone
+	std::unordered_map<std::string, aiMatrix4x4> offsets;
+	for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+	{
+		const aiMesh* mesh = scene->mMeshes[i];
+		for (unsigned int b = 0; b < mesh->mNumBones; ++b)
+			offsets.emplace(mesh->mBones[b]->mName.C_Str(), mesh->mBones[b]->mOffsetMatrix);
+	}
+
+	Skeleton skeleton;
+	if (offsets.empty())
+		return skeleton;
+
+	std::unordered_set<const aiNode*> needed;
+	for (const auto& [name, offset] : offsets)
+	{
+		const aiNode* node = scene->mRootNode->FindNode(name.c_str());
+		if (!node)
+		{
+			log_warning((source_path + ": no node for bone " + name + ", skinning dropped\n").c_str());
+			return skeleton;
+		}
+
+		for (; node && needed.insert(node).second; node = node->mParent) {}
+	}
+
+	addJoints(scene->mRootNode, -1, glm::mat4(1.0f), needed, offsets, skeleton);
+
+	if (skeleton.jointCount() > Skeleton::max_joints)
+	{
+		log_warning((source_path + ": more than 256 joints, skinning dropped\n").c_str());
+		return {};
+	}
+
+	return skeleton;
+}
+
+static void addMesh(const aiMesh* mesh, const std::unordered_map<std::string, uint32_t>& joint_indices, std::vector<Vertex>& verts, std::vector<SkinInfluence>& influences, std::vector<uint32_t>& indices)
+{
+	// every weight of every vertex, only the largest 4 are kept
+	const bool skinned = mesh->HasBones() && !joint_indices.empty();
+	std::vector<std::vector<uint32_t>> vertex_joints(skinned ? mesh->mNumVertices : 0);
+	std::vector<std::vector<float>> vertex_weights(skinned ? mesh->mNumVertices : 0);
+	for (unsigned int b = 0; skinned && b < mesh->mNumBones; ++b)
+	{
+		const aiBone* bone = mesh->mBones[b];
+		const uint32_t joint = joint_indices.at(bone->mName.C_Str());
+		for (unsigned int w = 0; w < bone->mNumWeights; ++w)
+		{
+			vertex_joints[bone->mWeights[w].mVertexId].push_back(joint);
+			vertex_weights[bone->mWeights[w].mVertexId].push_back(bone->mWeights[w].mWeight);
+		}
+	}
+
+	// weld vertices which are identical once reduced to the attributes we keep, assimp's own
+	// join also compares the generated normals and tangents
+	std::unordered_map<SkinnedVertex, uint32_t, VertexHash> unique_verts;
+	std::vector<uint32_t> remap(mesh->mNumVertices);
+
+	for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+	{
+		SkinnedVertex skinned_vert{};
+		Vertex& vert = skinned_vert.vert;
+
+		vert.pos = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+
+		vert.texCoord = glm::vec2(0.0f, 0.0f);
+		if (mesh->mTextureCoords[0])
+			vert.texCoord = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+
+		if (skinned)
+			skinned_vert.influence = packSkinInfluence(vertex_joints[i].data(), vertex_weights[i].data(), static_cast<uint32_t>(vertex_joints[i].size()));
+
+		auto inserted = unique_verts.emplace(skinned_vert, (uint32_t)verts.size());
+		if (inserted.second)
+		{
+			verts.push_back(vert);
+			if (skinned)
+				influences.push_back(skinned_vert.influence);
+		}
+
+		remap[i] = inserted.first->second;
+	}
+
+	for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+	{
+		// point and line primitives survive triangulation, they can't go in a triangle list
+		const auto& face = mesh->mFaces[i];
+		if (face.mNumIndices != 3)
+			continue;
+
+		for (unsigned int j = 0; j < face.mNumIndices; j++)
+			indices.push_back(remap[face.mIndices[j]]);
+	}
+}
+
+struct ImportedMesh
+{
+	std::vector<Vertex> verts;
+	std::vector<SkinInfluence> influences; // empty unless the mesh is skinned
+	std::vector<uint32_t> indices;
+	std::vector<uint16_t> short_indices; // final GPU indices if the mesh fits 16 bits
+	std::string texture_name;
+
+	glm::vec3 bounds_min = glm::vec3(0.0f);
+	glm::vec3 bounds_max = glm::vec3(0.0f);
+
+	VertexCacheStats stats_before;
+	VertexCacheStats stats_after;
+};
+
+static void importMesh(const aiScene* scene, unsigned int mesh_index, const std::unordered_map<std::string, uint32_t>& joint_indices, const MeshOptimizeSettings& optimize_settings, ImportedMesh& imported)
+{
+	auto& verts = imported.verts;
+	auto& influences = imported.influences;
+	auto& indices = imported.indices;
+	addMesh(scene->mMeshes[mesh_index], joint_indices, verts, influences, indices);
+	if (indices.empty()) return;
+
+	imported.stats_before = analyzeVertexCache(indices.data(), indices.size(), verts.size());
+
+	if (optimize_settings.vertex_cache)
+		optimizeVertexCache(indices.data(), indices.size(), verts.size());
+	if (optimize_settings.vertex_cache && optimize_settings.overdraw)
+		optimizeOverdraw(indices.data(), indices.size(), &verts[0].pos.x, verts.size(), sizeof(Vertex), optimize_settings.overdraw_threshold);
+	if (optimize_settings.vertex_fetch && influences.empty())
+		verts.resize(optimizeVertexFetch(verts.data(), verts.size(), sizeof(Vertex), indices.data(), indices.size()));
+	else if (optimize_settings.vertex_fetch)
+	{
+		// both streams have to end up in the same order
+		std::vector<SkinnedVertex> skinned_verts(verts.size());
+		for (size_t i = 0; i < verts.size(); ++i)
+			skinned_verts[i] = { verts[i], influences[i] };
+
+		skinned_verts.resize(optimizeVertexFetch(skinned_verts.data(), skinned_verts.size(), sizeof(SkinnedVertex), indices.data(), indices.size()));
+
+		verts.resize(skinned_verts.size());
+		influences.resize(skinned_verts.size());
+		for (size_t i = 0; i < skinned_verts.size(); ++i)
+		{
+			verts[i] = skinned_verts[i].vert;
+			influences[i] = skinned_verts[i].influence;
+		}
+	}
+
+	imported.stats_after = analyzeVertexCache(indices.data(), indices.size(), verts.size());
+
+	// indices are relative to the mesh's first vertex, so small meshes can use 16 bit indices
+	if (verts.size() <= UINT16_MAX)
+		imported.short_indices.assign(indices.begin(), indices.end());
+
+	imported.bounds_min = imported.bounds_max = verts[0].pos;
+	for (const auto& vert : verts)
+	{
+		imported.bounds_min = glm::min(imported.bounds_min, vert.pos);
+		imported.bounds_max = glm::max(imported.bounds_max, vert.pos);
+	}
+
+	aiMaterial* material = scene->mMaterials[scene->mMeshes[mesh_index]->mMaterialIndex];
+	if (material->GetTextureCount(aiTextureType_DIFFUSE) == 1)
+	{
+		aiString str;
+		material->GetTexture(aiTextureType_DIFFUSE, 0, &str);
+		imported.texture_name = str.C_Str();
+	}
+}
+
+static CachedMesh cachedView(const ImportedMesh& imported)
+{
+	CachedMesh mesh;
+	mesh.vertex_count = (uint32_t)imported.verts.size();
+	mesh.vertices = imported.verts.data();
+	mesh.influences = imported.influences.empty() ? nullptr : imported.influences.data();
+
+	if (!imported.short_indices.empty())
+	{
+		mesh.index_count = (uint32_t)imported.short_indices.size();
+		mesh.index_size = sizeof(uint16_t);
+		mesh.indices = imported.short_indices.data();
+	}
+	else
+	{
+		mesh.index_count = (uint32_t)imported.indices.size();
+		mesh.index_size = sizeof(uint32_t);
+		mesh.indices = imported.indices.data();
+	}
+
+	mesh.texture_name = imported.texture_name;
+	mesh.bounds_min = imported.bounds_min;
+	mesh.bounds_max = imported.bounds_max;
+	return mesh;
+}
+
+static void printStats(const std::string& file_path, const std::vector<ImportedMesh>& meshes)
+{
+	// transformed vertices summed over the model
+	float transformed_before = 0.0f, transformed_after = 0.0f;
+	size_t triangle_count = 0, vertex_count = 0;
+
+	for (const auto& mesh : meshes)
+	{
+		const size_t mesh_triangles = mesh.indices.size() / 3;
+		triangle_count += mesh_triangles;
+		vertex_count += mesh.verts.size();
+		transformed_before += mesh.stats_before.acmr * mesh_triangles;
+		transformed_after += mesh.stats_after.acmr * mesh_triangles;
+	}
+
+	if (triangle_count == 0)
+		return;
+
+	printf("%s: %zu triangles, %zu vertices, ACMR %.3f -> %.3f, ATVR %.3f -> %.3f\n", file_path.c_str(), triangle_count, vertex_count,
+		transformed_before / triangle_count, transformed_after / triangle_count, transformed_before / vertex_count, transformed_after / vertex_count);
+}
+
+bool hashModelSource(const std::string& source_path, uint64_t& hash)
+{
+	if (!hashFile(source_path, hash))
+		return false;
+
+	// gltf keeps its geometry in external .bin buffers next to the .gltf
+	std::error_code error;
+	const std::filesystem::path source(source_path);
+	if (source.extension() == ".gltf")
+	{
+		std::vector<std::filesystem::path> buffers;
+		for (const auto& entry : std::filesystem::directory_iterator(source.parent_path(), error))
+		{
+			if (entry.path().extension() == ".bin")
+				buffers.push_back(entry.path());
+		}
+
+		std::sort(buffers.begin(), buffers.end());
+		for (const auto& buffer : buffers)
+			hashFile(buffer.string(), hash);
+	}
+
+	return true;
+}
+
+bool cookModel(const std::string& source_path, const std::string& output_path, uint64_t key, const MeshOptimizeSettings& optimize_settings)
+{
+	Assimp::Importer importer;
+	const aiScene* scene = importer.ReadFile(source_path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals);
+
+	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
+	{
+		log_warning((source_path + ": " + importer.GetErrorString() + "\n").c_str());
+		return false;
+	}
+
+	Skeleton skeleton = importSkeleton(source_path, scene);
+
+	AnimationCookSettings animation_settings{};
+	animation_settings.print_stats = optimize_settings.print_stats;
+	skeleton.clips = cookAnimations(source_path, scene, skeleton, animation_settings);
+
+	std::unordered_map<std::string, uint32_t> joint_indices;
+	for (uint32_t i = 0; i < skeleton.jointCount(); ++i)
+		joint_indices.emplace(skeleton.names[i], i);
+
+	std::vector<ImportedMesh> imported_meshes(scene->mNumMeshes);
+	std::vector<CachedMesh> meshes;
+	for (unsigned int i = 0; i < scene->mNumMeshes; ++i)
+	{
+		importMesh(scene, i, joint_indices, optimize_settings, imported_meshes[i]);
+		if (!imported_meshes[i].indices.empty())
+			meshes.push_back(cachedView(imported_meshes[i]));
+	}
+
+	if (optimize_settings.print_stats)
+		printStats(source_path, imported_meshes);
+
+	return MeshCache::write(output_path, key, sizeof(Vertex), meshes, skeleton);
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "MeshOptimizer.h"
+
+#include <cstdint>
+#include <string>
+
+// content hash of a model file and the buffers it keeps next to it
+bool hashModelSource(const std::string& source_path, uint64_t& hash);
+
+// Imports a model with assimp, welds and optimises its meshes and writes them out as a MeshCache in the runtime
+// vertex layout. Geometry stays in model space, placing it is up to whoever draws it. Bones become a skeleton for the
+// whole model, with the 4 strongest influences of each skinned vertex stored next to its vertices and the model's
+// animations compressed against it
+bool cookModel(const std::string& source_path, const std::string& output_path, uint64_t key, const MeshOptimizeSettings& optimize_settings);
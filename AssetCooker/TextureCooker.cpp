@@ -0,0 +1,57 @@
+#include "TextureCooker.h"
+
+#include "CookedTexture.h"
+#include "MipGenerator.h"
+#include "TextureCompression.h"
+#include "VulkanWrapper/Log.h"
+
+#include <stb/stb_image.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+bool cookTexture(const std::string& source_path, const std::string& output_path)
+{
+    int width, height, channels;
+    stbi_uc* pixels = stbi_load(source_path.c_str(), &width, &height, &channels, STBI_rgb_alpha);
+
+    if (!pixels)
+    {
+        log_warning(("failed to load texture " + source_path + "\n").c_str());
+        return false;
+    }
+
+    // the whole chain is cooked, so the runtime never has to generate mips for cooked textures
+    const uint32_t level_count = std::min(mipLevelCount(width, height), CookedTexture::max_levels);
+    std::vector<unsigned char> chain(mipChainSize(width, height, level_count));
+    memcpy(chain.data(), pixels, size_t(width) * height * 4);
+    stbi_image_free(pixels);
+
+    generateMipChain(chain.data(), width, height, 1, level_count);
+
+    // BC1 where every texel is opaque, BC3 when there is alpha to keep
+    bool opaque = true;
+    for (size_t i = 3; i < size_t(width) * height * 4 && opaque; i += 4)
+        opaque = chain[i] == 255;
+    const VkFormat format = opaque ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC3_SRGB_BLOCK;
+
+    size_t compressed_size = 0;
+    for (uint32_t level = 0; level < level_count; ++level)
+        compressed_size += textureLevelSize(format, width, height, level);
+    std::vector<unsigned char> compressed(compressed_size);
+
+    CookedTexture::Level levels[CookedTexture::max_levels];
+    size_t offset = 0;
+    for (uint32_t level = 0; level < level_count; ++level)
+    {
+        const uint32_t level_width = std::max(1, width >> level);
+        const uint32_t level_height = std::max(1, height >> level);
+        compressImage(format, chain.data() + mipChainSize(width, height, level), level_width, level_height, compressed.data() + offset);
+
+        levels[level] = { compressed.data() + offset, textureLevelSize(format, width, height, level) };
+        offset += levels[level].size;
+    }
+
+    return CookedTexture::write(output_path, static_cast<uint32_t>(width), static_cast<uint32_t>(height), format, level_count, levels);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+#include <string>
+
+// Decodes an image to RGBA8, generates its full mip chain and writes it out block compressed as a KTX2 CookedTexture
+bool cookTexture(const std::string& source_path, const std::string& output_path);
@@ -0,0 +1,136 @@
+#include "AssetFile.h"
+
+#include <cstdio>
+#include <filesystem>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+bool MappedFile::open(const std::string& path)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    const void* view = mapping ? MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+    if (!view)
+    {
+        if (mapping) CloseHandle(mapping);
+        CloseHandle(file);
+        return false;
+    }
+
+    file_handle = file;
+    mapping_handle = mapping;
+    data = static_cast<const unsigned char*>(view);
+    size = static_cast<size_t>(file_size.QuadPart);
+#else
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    void* view = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        ::close(fd);
+        return false;
+    }
+
+    // the whole file is copied out right away
+    madvise(view, static_cast<size_t>(file_stat.st_size), MADV_SEQUENTIAL | MADV_WILLNEED);
+
+    file_descriptor = fd;
+    data = static_cast<const unsigned char*>(view);
+    size = static_cast<size_t>(file_stat.st_size);
+#endif
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (!data)
+        return;
+
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(mapping_handle);
+    CloseHandle(file_handle);
+    mapping_handle = nullptr;
+    file_handle = nullptr;
+#else
+    munmap(const_cast<unsigned char*>(data), size);
+    ::close(file_descriptor);
+    file_descriptor = -1;
+#endif
+
+    data = nullptr;
+    size = 0;
+}
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash)
+{
+    // FNV-1a
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 1099511628211ull;
+    return hash;
+}
+
+bool hashFile(const std::string& path, uint64_t& hash)
+{
+    MappedFile file;
+    if (!file.open(path))
+        return false;
+
+    hash = hashBytes(file.data, file.size, hash);
+    file.close();
+    return true;
+}
+
+bool writeFileAtomic(const std::string& path, const void* data, size_t size)
+{
+    // write to a temporary and rename, so a crash or a concurrent reader never sees a half written file
+    const std::string temp_path = path + ".tmp";
+    FILE* out = fopen(temp_path.c_str(), "wb");
+    if (!out)
+        return false;
+
+    const bool written = fwrite(data, 1, size, out) == size;
+    const bool closed = fclose(out) == 0;
+
+    std::error_code error;
+    if (written && closed)
+        std::filesystem::rename(temp_path, path, error);
+
+    if (!written || !closed || error)
+    {
+        std::filesystem::remove(temp_path, error);
+        return false;
+    }
+
+    return true;
+}
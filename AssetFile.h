@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read only view of a whole file, memory mapped so cooked data can be copied straight into staging memory
+struct MappedFile
+{
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+
+#ifdef _WIN32
+    void* file_handle = nullptr;
+    void* mapping_handle = nullptr;
+#else
+    int file_descriptor = -1;
+#endif
+
+    bool open(const std::string& path);
+    void close();
+};
+
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull);
+// returns false if the file could not be read, hash is left untouched then
+bool hashFile(const std::string& path, uint64_t& hash);
+
+// writes to a temporary next to path and renames it over path once complete
+bool writeFileAtomic(const std::string& path, const void* data, size_t size);
@@ -0,0 +1,240 @@
+#include "CookedTexture.h"
+
+#include "MipGenerator.h"
+#include "TextureCompression.h"
+#include "VulkanWrapper/Log.h"
+
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    constexpr unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+    struct FileHeader
+    {
+        unsigned char identifier[12];
+        uint32_t vk_format;
+        uint32_t type_size;
+        uint32_t pixel_width;
+        uint32_t pixel_height;
+        uint32_t pixel_depth;
+        uint32_t layer_count;
+        uint32_t face_count;
+        uint32_t level_count;
+        uint32_t supercompression_scheme;
+
+        uint32_t dfd_offset;
+        uint32_t dfd_length;
+        uint32_t kvd_offset;
+        uint32_t kvd_length;
+        uint64_t sgd_offset;
+        uint64_t sgd_length;
+    };
+    static_assert(sizeof(FileHeader) == 80, "KTX2 header is 80 bytes");
+
+    struct FileLevel
+    {
+        uint64_t offset;
+        uint64_t length;
+        uint64_t uncompressed_length;
+    };
+
+    // data format descriptor values, see the Khronos Data Format specification
+    constexpr uint32_t colour_model_rgbsda = 1;
+    constexpr uint32_t colour_model_bc1a = 128;
+    constexpr uint32_t colour_model_bc3 = 130;
+    constexpr uint32_t primaries_bt709 = 1;
+    constexpr uint32_t transfer_srgb = 2;
+    constexpr uint32_t qualifier_linear = 0x10;
+
+    struct DfdSample
+    {
+        uint32_t channel; // including qualifiers
+        uint32_t bit_offset;
+        uint32_t bit_length;
+        uint32_t upper;
+    };
+
+    std::vector<uint32_t> dataFormatDescriptor(VkFormat format)
+    {
+        FormatBlockInfo block;
+        formatBlockInfo(format, block);
+
+        uint32_t colour_model;
+        std::vector<DfdSample> samples;
+        switch (format)
+        {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            colour_model = colour_model_bc1a;
+            samples = { { 0, 0, 64, 0xFFFFFFFF } };
+            break;
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            colour_model = colour_model_bc1a;
+            samples = { { 1, 0, 64, 0xFFFFFFFF } };
+            break;
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            colour_model = colour_model_bc3;
+            samples = { { 15 | qualifier_linear, 0, 64, 0xFFFFFFFF }, { 0, 64, 64, 0xFFFFFFFF } };
+            break;
+        default:
+            colour_model = colour_model_rgbsda;
+            samples = { { 0, 0, 8, 255 }, { 1, 8, 8, 255 }, { 2, 16, 8, 255 }, { 15 | qualifier_linear, 24, 8, 255 } };
+            break;
+        }
+
+        const uint32_t block_size = 24 + 16 * static_cast<uint32_t>(samples.size());
+
+        std::vector<uint32_t> words;
+        words.push_back(4 + block_size); // total size
+        words.push_back(0); // vendor khronos, descriptor type basic
+        words.push_back(2 | (block_size << 16)); // version 1.3
+        words.push_back(colour_model | (primaries_bt709 << 8) | (transfer_srgb << 16));
+        words.push_back((block.block_width - 1) | ((block.block_height - 1) << 8));
+        words.push_back(block.block_bytes);
+        words.push_back(0);
+
+        for (const DfdSample& sample : samples)
+        {
+            words.push_back(sample.bit_offset | ((sample.bit_length - 1) << 16) | (sample.channel << 24));
+            words.push_back(0); // sample position
+            words.push_back(0); // lower
+            words.push_back(sample.upper);
+        }
+
+        return words;
+    }
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+bool CookedTexture::open(const std::string& path)
+{
+    if (!file.open(path))
+        return false;
+
+    auto fail = [&](const char* reason)
+    {
+        log_warning(("unsupported KTX2 file " + path + ": " + reason + "\n").c_str());
+        close();
+        return false;
+    };
+
+    FileHeader header;
+    if (file.size < sizeof(header))
+        return fail("truncated header");
+    memcpy(&header, file.data, sizeof(header));
+
+    if (memcmp(header.identifier, identifier, sizeof(identifier)) != 0)
+        return fail("not a KTX2 file");
+
+    FormatBlockInfo block;
+    const VkFormat file_format = static_cast<VkFormat>(header.vk_format);
+    if (!formatBlockInfo(file_format, block))
+        return fail("format");
+
+    // cooked textures are always full 2D images with their mips already in the file
+    if (header.pixel_depth > 1 || header.layer_count > 1 || header.face_count != 1 || header.supercompression_scheme != 0)
+        return fail("not a plain 2D texture");
+    if (header.pixel_width == 0 || header.pixel_height == 0 || header.level_count == 0
+        || header.level_count > max_levels || header.level_count > mipLevelCount(header.pixel_width, header.pixel_height))
+        return fail("dimensions");
+    if (sizeof(FileHeader) + uint64_t(header.level_count) * sizeof(FileLevel) > file.size)
+        return fail("truncated level index");
+
+    for (uint32_t level = 0; level < header.level_count; ++level)
+    {
+        FileLevel file_level;
+        memcpy(&file_level, file.data + sizeof(FileHeader) + level * sizeof(FileLevel), sizeof(file_level));
+
+        const size_t expected = textureLevelSize(file_format, header.pixel_width, header.pixel_height, level);
+        if (file_level.length != expected || file_level.offset > file.size || file_level.length > file.size - file_level.offset)
+            return fail("level data");
+
+        levels[level] = { file.data + file_level.offset, static_cast<size_t>(file_level.length) };
+    }
+
+    width = header.pixel_width;
+    height = header.pixel_height;
+    format = file_format;
+    level_count = header.level_count;
+    return true;
+}
+
+void CookedTexture::close()
+{
+    file.close();
+    width = 0;
+    height = 0;
+    format = VK_FORMAT_UNDEFINED;
+    level_count = 0;
+    memset(levels, 0, sizeof(levels));
+}
+
+bool CookedTexture::write(const std::string& path, uint32_t width, uint32_t height, VkFormat format, uint32_t level_count, const Level* levels)
+{
+    FormatBlockInfo block;
+    if (!formatBlockInfo(format, block) || level_count == 0 || level_count > max_levels)
+    {
+        log_warning(("can't write cooked texture " + path + " in this format\n").c_str());
+        return false;
+    }
+
+    const std::vector<uint32_t> dfd = dataFormatDescriptor(format);
+
+    static const char writer_key[] = "KTXwriter";
+    static const char writer_value[] = "asset_cooker";
+    const uint32_t kvd_entry_length = sizeof(writer_key) + sizeof(writer_value);
+
+    FileHeader header{};
+    memcpy(header.identifier, identifier, sizeof(identifier));
+    header.vk_format = format;
+    header.type_size = 1;
+    header.pixel_width = width;
+    header.pixel_height = height;
+    header.face_count = 1;
+    header.level_count = level_count;
+
+    uint64_t offset = sizeof(FileHeader) + uint64_t(level_count) * sizeof(FileLevel);
+    header.dfd_offset = static_cast<uint32_t>(offset);
+    header.dfd_length = static_cast<uint32_t>(dfd.size() * sizeof(uint32_t));
+    offset += header.dfd_length;
+
+    header.kvd_offset = static_cast<uint32_t>(offset);
+    header.kvd_length = static_cast<uint32_t>(alignUp(sizeof(uint32_t) + kvd_entry_length, 4));
+    offset += header.kvd_length;
+
+    // the smallest level goes first, each one aligned to lcm(texel block size, 4)
+    const uint64_t level_alignment = block.block_bytes % 4 == 0 ? block.block_bytes : block.block_bytes * 4;
+    std::vector<FileLevel> file_levels(level_count);
+    for (uint32_t level = level_count; level-- > 0;)
+    {
+        offset = alignUp(offset, level_alignment);
+        file_levels[level] = { offset, levels[level].size, levels[level].size };
+        offset += levels[level].size;
+    }
+
+    std::vector<unsigned char> contents(offset, 0);
+    memcpy(contents.data(), &header, sizeof(header));
+    memcpy(contents.data() + sizeof(FileHeader), file_levels.data(), file_levels.size() * sizeof(FileLevel));
+    memcpy(contents.data() + header.dfd_offset, dfd.data(), header.dfd_length);
+
+    unsigned char* kvd = contents.data() + header.kvd_offset;
+    memcpy(kvd, &kvd_entry_length, sizeof(kvd_entry_length));
+    memcpy(kvd + sizeof(uint32_t), writer_key, sizeof(writer_key));
+    memcpy(kvd + sizeof(uint32_t) + sizeof(writer_key), writer_value, sizeof(writer_value));
+
+    for (uint32_t level = 0; level < level_count; ++level)
+        memcpy(contents.data() + file_levels[level].offset, levels[level].data, levels[level].size);
+
+    if (!writeFileAtomic(path, contents.data(), contents.size()))
+    {
+        log_warning(("failed to write cooked texture " + path + "\n").c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "AssetFile.h"
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <string>
+
+// A texture cooked by the asset cooker, stored as a KTX2 container holding a pre-mipped 2D texture in one of the
+// formats from TextureCompression.h. Any non-supercompressed single layer KTX2 file in those formats can be opened
+struct CookedTexture
+{
+    // of what the cooker writes, the container itself is plain KTX2
+    static constexpr uint32_t version = 3;
+    static constexpr uint32_t max_levels = 16;
+
+    struct Level
+    {
+        const unsigned char* data; // points into the mapped file
+        size_t size;
+    };
+
+    MappedFile file;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    uint32_t level_count = 0;
+    Level levels[max_levels] = {}; // level 0 is the full size image
+
+    bool open(const std::string& path);
+    void close();
+
+    static bool write(const std::string& path, uint32_t width, uint32_t height, VkFormat format, uint32_t level_count, const Level* levels);
+};
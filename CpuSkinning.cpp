@@ -0,0 +1,194 @@
+#include "CpuSkinning.h"
+#include "CpuSkinningKernels.h"
+
+#include <algorithm>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define SKINNING_X86 1
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+static constexpr float weight_scale = 1.0f / 65535.0f;
+
+const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Sse4: return "SSE4.1";
+    case SimdLevel::Avx2: return "AVX2";
+    case SimdLevel::Avx512: return "AVX-512";
+    default: return "scalar";
+    }
+}
+
+#ifdef SKINNING_X86
+static void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t registers[4])
+{
+#ifdef _MSC_VER
+    int values[4];
+    __cpuidex(values, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (int i = 0; i < 4; ++i)
+        registers[i] = static_cast<uint32_t>(values[i]);
+#else
+    __cpuid_count(leaf, subleaf, registers[0], registers[1], registers[2], registers[3]);
+#endif
+}
+
+// which register state the OS saves on context switches, only valid with OSXSAVE
+static uint64_t enabledRegisterState()
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+#endif
+
+SimdLevel detectSimdLevel()
+{
+#ifdef SKINNING_X86
+    uint32_t registers[4];
+    cpuid(0, 0, registers);
+    const uint32_t max_leaf = registers[0];
+
+    cpuid(1, 0, registers);
+    const bool sse41 = registers[2] & (1u << 19);
+    const bool fma = registers[2] & (1u << 12);
+    const bool osxsave = registers[2] & (1u << 27);
+    const bool avx = registers[2] & (1u << 28);
+    if (!sse41)
+        return SimdLevel::Scalar;
+
+    if (!osxsave || !avx || max_leaf < 7)
+        return SimdLevel::Sse4;
+
+    // xmm and ymm state for AVX, plus opmask and both halves of zmm for AVX-512
+    const uint64_t register_state = enabledRegisterState();
+    const bool ymm_enabled = (register_state & 0x6) == 0x6;
+    const bool zmm_enabled = (register_state & 0xE6) == 0xE6;
+
+    cpuid(7, 0, registers);
+    const bool avx2 = registers[1] & (1u << 5);
+    const bool avx512f = registers[1] & (1u << 16);
+
+    if (avx512f && zmm_enabled)
+        return SimdLevel::Avx512;
+    if (avx2 && fma && ymm_enabled)
+        return SimdLevel::Avx2;
+    return SimdLevel::Sse4;
+#else
+    return SimdLevel::Scalar;
+#endif
+}
+
+void SkinningStreams::assign(const Vertex* vertices, const SkinInfluence* influences, size_t vertex_count)
+{
+    for (auto& stream : position)
+        stream.resize(vertex_count);
+    for (uint32_t s = 0; s < 4; ++s)
+    {
+        joints[s].resize(vertex_count);
+        weights[s].resize(vertex_count);
+    }
+
+    for (size_t i = 0; i < vertex_count; ++i)
+    {
+        position[0][i] = vertices[i].pos.x;
+        position[1][i] = vertices[i].pos.y;
+        position[2][i] = vertices[i].pos.z;
+
+        for (uint32_t s = 0; s < 4; ++s)
+        {
+            joints[s][i] = influences[i].joints[s];
+            weights[s][i] = influences[i].weights[s];
+        }
+    }
+}
+
+void SkinnedPositions::resize(size_t vertex_count)
+{
+    for (auto& stream : position)
+        stream.resize(vertex_count);
+}
+
+void skinVerticesScalar(const SkinningView& view, size_t first, size_t count)
+{
+    for (size_t i = first; i < first + count; ++i)
+    {
+        // the blended matrix's upper 3 rows, column major
+        float blended[12] = {};
+        for (uint32_t s = 0; s < 4; ++s)
+        {
+            const float* joint = view.palette + view.joints[s][i] * 16;
+            const float weight = view.weights[s][i] * weight_scale;
+            for (uint32_t column = 0; column < 4; ++column)
+            {
+                for (uint32_t row = 0; row < 3; ++row)
+                    blended[column * 3 + row] += joint[column * 4 + row] * weight;
+            }
+        }
+
+        const float x = view.position[0][i];
+        const float y = view.position[1][i];
+        const float z = view.position[2][i];
+        for (uint32_t row = 0; row < 3; ++row)
+            view.skinned[row][i] = blended[row] * x + blended[3 + row] * y + blended[6 + row] * z + blended[9 + row];
+    }
+}
+
+void skinVertices(SimdLevel level, const SkinningStreams& streams, const glm::mat4* palette, size_t first, size_t count, SkinnedPositions& out)
+{
+    SkinningView view{};
+    for (uint32_t axis = 0; axis < 3; ++axis)
+    {
+        view.position[axis] = streams.position[axis].data();
+        view.skinned[axis] = out.position[axis].data();
+    }
+    for (uint32_t s = 0; s < 4; ++s)
+    {
+        view.joints[s] = streams.joints[s].data();
+        view.weights[s] = streams.weights[s].data();
+    }
+    view.palette = &palette[0][0][0];
+
+    switch (level)
+    {
+#ifdef SKINNING_X86
+    case SimdLevel::Sse4: skinVerticesSse4(view, first, count); break;
+    case SimdLevel::Avx2: skinVerticesAvx2(view, first, count); break;
+    case SimdLevel::Avx512: skinVerticesAvx512(view, first, count); break;
+#endif
+    default: skinVerticesScalar(view, first, count); break;
+    }
+}
+
+void skinVerticesParallel(ThreadPool& thread_pool, SimdLevel level, const SkinningStreams& streams, const glm::mat4* palette, SkinnedPositions& out, size_t chunk_size)
+{
+    const size_t vertex_count = streams.vertexCount();
+    const size_t chunk_count = (vertex_count + chunk_size - 1) / chunk_size;
+
+    thread_pool.parallelFor(chunk_count, [&](size_t chunk, uint32_t thread_index)
+    {
+        const size_t first = chunk * chunk_size;
+        skinVertices(level, streams, palette, first, std::min(chunk_size, vertex_count - first), out);
+    });
+}
+
+void skinVerticesReference(const Vertex* vertices, const SkinInfluence* influences, size_t vertex_count, const glm::mat4* palette, glm::vec3* out)
+{
+    for (size_t i = 0; i < vertex_count; ++i)
+    {
+        glm::mat4 skin = glm::mat4(0.0f);
+        for (uint32_t s = 0; s < 4; ++s)
+            skin += palette[influences[i].joints[s]] * (influences[i].weights[s] * weight_scale);
+
+        out[i] = glm::vec3(skin * glm::vec4(vertices[i].pos, 1.0f));
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Skeleton.h"
+#include "ThreadPool.h"
+#include "Vertex.h"
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// CPU linear blend skinning, for tools, collision and picking against deformed meshes, and as the oracle the GPU
+// paths are checked against. Vertices are kept as structure of arrays so each kernel loads a full register of one
+// attribute at a time. The kernel is chosen once from what the CPU supports, every level produces the same result
+// as the scalar one up to float rounding.
+
+enum class SimdLevel
+{
+    Scalar,
+    Sse4, // SSE4.1
+    Avx2, // with FMA
+    Avx512, // AVX-512F
+};
+
+const char* simdLevelName(SimdLevel level);
+
+// the best level both the CPU and the OS (for the wider register state) support, Scalar off x86
+SimdLevel detectSimdLevel();
+
+// A skinned mesh split into one array per attribute, built from the vertices and influences the loader imports
+struct SkinningStreams
+{
+    std::vector<float> position[3];
+    std::vector<uint8_t> joints[4];
+    std::vector<uint16_t> weights[4];
+
+    size_t vertexCount() const { return position[0].size(); }
+
+    void assign(const Vertex* vertices, const SkinInfluence* influences, size_t vertex_count);
+};
+
+struct SkinnedPositions
+{
+    std::vector<float> position[3];
+
+    void resize(size_t vertex_count);
+};
+
+// Skins positions [first, first + count) of streams with palette, as built by Skeleton::buildPalette. out must hold
+// streams.vertexCount() positions
+void skinVertices(SimdLevel level, const SkinningStreams& streams, const glm::mat4* palette, size_t first, size_t count, SkinnedPositions& out);
+
+// every vertex, in chunks of chunk_size on the thread pool
+void skinVerticesParallel(ThreadPool& thread_pool, SimdLevel level, const SkinningStreams& streams, const glm::mat4* palette, SkinnedPositions& out, size_t chunk_size = 16384);
+
+// Straightforward skinning of the loader's interleaved data with glm, the same blend as shader.vert and
+// skinning.comp. out holds vertex_count positions
+void skinVerticesReference(const Vertex* vertices, const SkinInfluence* influences, size_t vertex_count, const glm::mat4* palette, glm::vec3* out);
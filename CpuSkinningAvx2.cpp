@@ -0,0 +1,50 @@
+#include "CpuSkinningKernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+
+// 8 vertices per register, one lane each. The upper 3 rows of every influencing joint are gathered and blended,
+// then applied to the positions
+void skinVerticesAvx2(const SkinningView& view, size_t first, size_t count)
+{
+    const __m256 weight_scale = _mm256_set1_ps(1.0f / 65535.0f);
+
+    size_t i = first;
+    for (; i + 8 <= first + count; i += 8)
+    {
+        // column major, element column * 3 + row
+        __m256 blended[12];
+        for (int e = 0; e < 12; ++e)
+            blended[e] = _mm256_setzero_ps();
+
+        for (int s = 0; s < 4; ++s)
+        {
+            const __m256i joint_offsets = _mm256_slli_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(view.joints[s] + i))), 4);
+            const __m256i weights = _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(view.weights[s] + i)));
+            const __m256 weight = _mm256_mul_ps(_mm256_cvtepi32_ps(weights), weight_scale);
+
+            for (int column = 0; column < 4; ++column)
+            {
+                for (int row = 0; row < 3; ++row)
+                {
+                    const __m256 element = _mm256_i32gather_ps(view.palette + column * 4 + row, joint_offsets, 4);
+                    blended[column * 3 + row] = _mm256_fmadd_ps(element, weight, blended[column * 3 + row]);
+                }
+            }
+        }
+
+        const __m256 x = _mm256_loadu_ps(view.position[0] + i);
+        const __m256 y = _mm256_loadu_ps(view.position[1] + i);
+        const __m256 z = _mm256_loadu_ps(view.position[2] + i);
+        for (int row = 0; row < 3; ++row)
+        {
+            __m256 skinned = _mm256_fmadd_ps(blended[row], x, blended[9 + row]);
+            skinned = _mm256_fmadd_ps(blended[3 + row], y, skinned);
+            skinned = _mm256_fmadd_ps(blended[6 + row], z, skinned);
+            _mm256_storeu_ps(view.skinned[row] + i, skinned);
+        }
+    }
+
+    skinVerticesScalar(view, i, first + count - i);
+}
+#endif
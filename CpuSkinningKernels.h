@@ -0,0 +1,25 @@
+#pragma once
+
+// Interface between CpuSkinning.cpp and the per instruction set kernels. Each kernel lives in its own translation
+// unit built with that instruction set enabled (see CMakeLists.txt), so this header stays free of the standard
+// library and glm: inline functions instantiated there could otherwise be picked by the linker for every caller and
+// execute AVX-512 on machines without it.
+
+#include <cstddef>
+#include <cstdint>
+
+// raw pointers into a SkinningStreams and its output for one skinning call
+struct SkinningView
+{
+    const float* position[3]; // x, y, z
+    const uint8_t* joints[4]; // influence slot s of every vertex
+    const uint16_t* weights[4]; // unorm16, the 4 slots of a vertex sum to 65535
+    const float* palette; // column major mat4s, 16 floats per joint
+    float* skinned[3];
+};
+
+// linear blend skinning of positions [first, first + count), each kernel handles its own remainder
+void skinVerticesScalar(const SkinningView& view, size_t first, size_t count);
+void skinVerticesSse4(const SkinningView& view, size_t first, size_t count);
+void skinVerticesAvx2(const SkinningView& view, size_t first, size_t count);
+void skinVerticesAvx512(const SkinningView& view, size_t first, size_t count);
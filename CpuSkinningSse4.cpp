@@ -0,0 +1,50 @@
+#include "CpuSkinningKernels.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#include <smmintrin.h>
+
+// 4 vertices at a time, without gathers: each vertex blends its joints' columns in a register of its own and the
+// 4 results are transposed back into the output streams
+void skinVerticesSse4(const SkinningView& view, size_t first, size_t count)
+{
+    const __m128 weight_scale = _mm_set1_ps(1.0f / 65535.0f);
+
+    size_t i = first;
+    for (; i + 4 <= first + count; i += 4)
+    {
+        // slot s's weights of all 4 vertices, converted together
+        alignas(16) float slot_weights[4][4];
+        for (int s = 0; s < 4; ++s)
+        {
+            const __m128i weights = _mm_cvtepu16_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(view.weights[s] + i)));
+            _mm_store_ps(slot_weights[s], _mm_mul_ps(_mm_cvtepi32_ps(weights), weight_scale));
+        }
+
+        __m128 skinned[4];
+        for (int v = 0; v < 4; ++v)
+        {
+            __m128 columns[4] = { _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps(), _mm_setzero_ps() };
+            for (int s = 0; s < 4; ++s)
+            {
+                const float* joint = view.palette + view.joints[s][i + v] * 16;
+                const __m128 weight = _mm_set1_ps(slot_weights[s][v]);
+
+                for (int c = 0; c < 4; ++c)
+                    columns[c] = _mm_add_ps(columns[c], _mm_mul_ps(_mm_loadu_ps(joint + c * 4), weight));
+            }
+
+            skinned[v] = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(columns[0], _mm_set1_ps(view.position[0][i + v])), _mm_mul_ps(columns[1], _mm_set1_ps(view.position[1][i + v]))),
+                _mm_add_ps(_mm_mul_ps(columns[2], _mm_set1_ps(view.position[2][i + v])), columns[3]));
+        }
+
+        // rows become x, y, z (and the unused w) of the 4 vertices
+        _MM_TRANSPOSE4_PS(skinned[0], skinned[1], skinned[2], skinned[3]);
+        _mm_storeu_ps(view.skinned[0] + i, skinned[0]);
+        _mm_storeu_ps(view.skinned[1] + i, skinned[1]);
+        _mm_storeu_ps(view.skinned[2] + i, skinned[2]);
+    }
+
+    skinVerticesScalar(view, i, first + count - i);
+}
+#endif
@@ -2,6 +2,8 @@
 
 #include <VulkanWrapper/Log.h>
 
+#include <algorithm>
+
 #include <imgui/backends/imgui_impl_vulkan.h>
 #include <imgui/backends/imgui_impl_glfw.h>
 
@@ -131,7 +133,8 @@ void ImguiImpl::init(VulkanInstance& instance)
 	init_info.DescriptorPool = descriptor_pool;
 	init_info.Allocator = nullptr;
 	init_info.MinImageCount = instance.swapchain.images.size();
-	init_info.ImageCount = instance.swapchain.images.size();
+	// imgui rotates its vertex buffers by ImageCount, which must cover every frame in flight
+	init_info.ImageCount = std::max<uint32_t>(instance.swapchain.images.size(), instance.frames_in_flight);
 	init_info.CheckVkResultFn = nullptr;
 
 	render_pass = createRenderPass(instance.device_manager.logicalDevice, instance.swapchain.image_format);
@@ -144,7 +147,7 @@ void ImguiImpl::init(VulkanInstance& instance)
 	ImGui_ImplVulkan_CreateFontsTexture(command_buffer.getHandle());
 	command_buffer.end(instance.device_manager);
 
-	command_buffer_set.init(instance.device_manager, init_info.ImageCount);
+	command_buffer_set.init(instance.device_manager, instance.frames_in_flight);
 }
 
 void ImguiImpl::deinit(VulkanInstance& instance)
@@ -153,6 +156,8 @@ void ImguiImpl::deinit(VulkanInstance& instance)
 		vkDestroyFramebuffer(instance.device_manager.logicalDevice, framebuffers[i], nullptr);
 	vkDestroyRenderPass(instance.device_manager.logicalDevice, render_pass, nullptr);
 
+	command_buffer_set.deinit(instance.device_manager);
+
 	ImGui_ImplVulkan_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	
@@ -163,11 +168,13 @@ void ImguiImpl::swapchainRecreate(VulkanInstance& instance)
 {
 	ImGui_ImplVulkan_SetMinImageCount(instance.swapchain.images.size());
 
-	command_buffer_set.deinit(instance.device_manager);
-	command_buffer_set.init(instance.device_manager, instance.swapchain.images.size());
+	// the framebuffers wrap the swapchain image views, the command buffers are per frame and survive
+	for (size_t i = 0; i < framebuffers.size(); i++)
+		vkDestroyFramebuffer(instance.device_manager.logicalDevice, framebuffers[i], nullptr);
+	createFramebuffers(instance, framebuffers, render_pass);
 }
 
-void ImguiImpl::renderFrame(VulkanInstance& instance, size_t frame_index)
+void ImguiImpl::renderFrame(VulkanInstance& instance, size_t frame_index, uint32_t image_index)
 {
 	ImGui_ImplVulkan_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
@@ -177,12 +184,12 @@ void ImguiImpl::renderFrame(VulkanInstance& instance, size_t frame_index)
 
 	auto draw_data = ImGui::GetDrawData();
 
-	command_buffer_set.begin(frame_index, 0);
+	command_buffer_set.begin(frame_index, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
 	VkRenderPassBeginInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
     renderPassInfo.renderPass = render_pass;
-    renderPassInfo.framebuffer = framebuffers[frame_index];
+    renderPassInfo.framebuffer = framebuffers[image_index];
     renderPassInfo.renderArea.offset = { 0, 0 };
     renderPassInfo.renderArea.extent = instance.swapchain.extent;
     std::array<VkClearValue, 2> clearValues{};
@@ -6,12 +6,12 @@ struct ImguiImpl
 {
 	VkDescriptorPool descriptor_pool;
 	VkRenderPass render_pass;
-	CommandBufferSet command_buffer_set;
+	CommandBufferSet command_buffer_set; // per frame in flight
 	std::vector<VkFramebuffer> framebuffers;
 
 	void init(VulkanInstance& instance);
 	void deinit(VulkanInstance& instance);
 
 	void swapchainRecreate(VulkanInstance& instance);
-	void renderFrame(VulkanInstance& instance, size_t frame_index);
+	void renderFrame(VulkanInstance& instance, size_t frame_index, uint32_t image_index);
 };
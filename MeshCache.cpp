@@ -0,0 +1,402 @@
+#include "MeshCache.h"
+
+#include "VulkanWrapper/Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+    constexpr char magic[4] = { 'M', 'S', 'H', 'C' };
+    constexpr uint64_t blob_alignment = 16;
+
+    struct FileHeader
+    {
+        char magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t vertex_stride;
+        uint32_t mesh_count;
+        uint32_t joint_count;
+        uint32_t clip_count;
+        uint64_t skeleton_offset;
+        uint64_t clips_offset;
+    };
+
+    struct FileMesh
+    {
+        uint32_t vertex_count;
+        uint32_t index_count;
+        uint32_t index_size;
+        uint32_t texture_name_length;
+        uint64_t vertex_offset;
+        uint64_t index_offset;
+        uint64_t texture_name_offset;
+        uint64_t influence_offset; // 0 for static meshes
+        float bounds_min[3];
+        float bounds_max[3];
+    };
+
+    struct FileJoint
+    {
+        int32_t parent;
+        uint32_t name_length;
+        uint64_t name_offset;
+        float bind_local[16];
+        float inverse_bind[16];
+    };
+
+    struct FileClip
+    {
+        uint32_t name_length;
+        uint32_t joint_count;
+        uint64_t name_offset;
+        float duration;
+        uint32_t key_counts[AnimationClip::channel_count];
+        uint64_t tracks_offset; // joint_count FileTracks per channel, channel by channel
+        uint64_t times_offset[AnimationClip::channel_count];
+        uint64_t keys_offset[AnimationClip::channel_count];
+    };
+
+    struct FileTrack
+    {
+        uint32_t first_key;
+        uint32_t key_count;
+        float range_min[3];
+        float range_extent[3];
+    };
+
+    uint64_t alignUp(uint64_t value, uint64_t alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    // the GPU reads vertices and palette entries through these unchecked, so a bad cache must not get that far
+    template<typename Index>
+    bool indicesInRange(const uint8_t* indices, uint32_t index_count, uint32_t vertex_count)
+    {
+        for (uint32_t i = 0; i < index_count; ++i)
+        {
+            Index index;
+            memcpy(&index, indices + size_t(i) * sizeof(Index), sizeof(index));
+            if (index >= vertex_count)
+                return false;
+        }
+        return true;
+    }
+
+    bool influencesInRange(const uint8_t* influences, uint32_t vertex_count, uint32_t joint_count)
+    {
+        for (uint32_t i = 0; i < vertex_count; ++i)
+        {
+            SkinInfluence influence;
+            memcpy(&influence, influences + size_t(i) * sizeof(SkinInfluence), sizeof(influence));
+            for (uint8_t joint : influence.joints)
+            {
+                if (joint >= joint_count)
+                    return false;
+            }
+        }
+        return true;
+    }
+}
+
+bool MeshCache::open(const std::string& path, uint32_t vertex_stride)
+{
+    if (!file.open(path))
+        return false;
+
+    auto fail = [&]()
+    {
+        close();
+        return false;
+    };
+
+    if (file.size < sizeof(FileHeader))
+        return fail();
+
+    FileHeader header;
+    memcpy(&header, file.data, sizeof(header));
+
+    if (memcmp(header.magic, magic, sizeof(magic)) != 0 || header.version != version || header.vertex_stride != vertex_stride)
+        return fail();
+
+    if (sizeof(FileHeader) + uint64_t(header.mesh_count) * sizeof(FileMesh) > file.size)
+        return fail();
+
+    auto in_file = [&](uint64_t offset, uint64_t bytes) { return offset <= file.size && bytes <= file.size - offset; };
+
+    if (header.joint_count > Skeleton::max_joints || !in_file(header.skeleton_offset, uint64_t(header.joint_count) * sizeof(FileJoint)))
+        return fail();
+
+    skeleton = {};
+    for (uint32_t i = 0; i < header.joint_count; ++i)
+    {
+        FileJoint file_joint;
+        memcpy(&file_joint, file.data + header.skeleton_offset + i * sizeof(FileJoint), sizeof(file_joint));
+
+        // parents before children is what lets poses propagate in one pass
+        if (file_joint.parent >= static_cast<int32_t>(i) || !in_file(file_joint.name_offset, file_joint.name_length))
+            return fail();
+
+        glm::mat4 bind_local, inverse_bind;
+        memcpy(&bind_local[0][0], file_joint.bind_local, sizeof(file_joint.bind_local));
+        memcpy(&inverse_bind[0][0], file_joint.inverse_bind, sizeof(file_joint.inverse_bind));
+
+        skeleton.names.emplace_back(reinterpret_cast<const char*>(file.data + file_joint.name_offset), file_joint.name_length);
+        skeleton.parents.push_back(std::max(file_joint.parent, -1));
+        skeleton.bind_locals.push_back(bind_local);
+        skeleton.inverse_binds.push_back(inverse_bind);
+    }
+
+    if (header.clip_count && (skeleton.empty() || !in_file(header.clips_offset, uint64_t(header.clip_count) * sizeof(FileClip))))
+        return fail();
+
+    for (uint32_t i = 0; i < header.clip_count; ++i)
+    {
+        FileClip file_clip;
+        memcpy(&file_clip, file.data + header.clips_offset + i * sizeof(FileClip), sizeof(file_clip));
+
+        if (file_clip.joint_count != skeleton.jointCount() || !(file_clip.duration >= 0.0f)
+            || !in_file(file_clip.name_offset, file_clip.name_length)
+            || !in_file(file_clip.tracks_offset, uint64_t(file_clip.joint_count) * AnimationClip::channel_count * sizeof(FileTrack)))
+            return fail();
+
+        AnimationClip& clip = skeleton.clips.emplace_back();
+        clip.name.assign(reinterpret_cast<const char*>(file.data + file_clip.name_offset), file_clip.name_length);
+        clip.duration = file_clip.duration;
+        clip.joint_count = file_clip.joint_count;
+
+        for (uint32_t channel = 0; channel < AnimationClip::channel_count; ++channel)
+        {
+            const uint32_t key_count = file_clip.key_counts[channel];
+            const size_t key_size = channel == AnimationClip::Rotation ? sizeof(PackedRotation) : sizeof(PackedVector);
+            if (!in_file(file_clip.times_offset[channel], uint64_t(key_count) * sizeof(uint16_t)) || !in_file(file_clip.keys_offset[channel], uint64_t(key_count) * key_size))
+                return fail();
+
+            // sampling trusts every track to stay inside its channel's keys
+            clip.tracks[channel].resize(clip.joint_count);
+            for (uint32_t j = 0; j < clip.joint_count; ++j)
+            {
+                FileTrack file_track;
+                memcpy(&file_track, file.data + file_clip.tracks_offset + (size_t(channel) * clip.joint_count + j) * sizeof(FileTrack), sizeof(file_track));
+                if (file_track.key_count == 0 || file_track.first_key > key_count || file_track.key_count > key_count - file_track.first_key)
+                    return fail();
+
+                AnimationTrack& track = clip.tracks[channel][j];
+                track.first_key = file_track.first_key;
+                track.key_count = file_track.key_count;
+                track.range_min = glm::vec3(file_track.range_min[0], file_track.range_min[1], file_track.range_min[2]);
+                track.range_extent = glm::vec3(file_track.range_extent[0], file_track.range_extent[1], file_track.range_extent[2]);
+            }
+
+            clip.times[channel].resize(key_count);
+            memcpy(clip.times[channel].data(), file.data + file_clip.times_offset[channel], key_count * sizeof(uint16_t));
+        }
+
+        clip.rotations.resize(file_clip.key_counts[AnimationClip::Rotation]);
+        clip.translations.resize(file_clip.key_counts[AnimationClip::Translation]);
+        clip.scales.resize(file_clip.key_counts[AnimationClip::Scale]);
+        memcpy(clip.rotations.data(), file.data + file_clip.keys_offset[AnimationClip::Rotation], clip.rotations.size() * sizeof(PackedRotation));
+        memcpy(clip.translations.data(), file.data + file_clip.keys_offset[AnimationClip::Translation], clip.translations.size() * sizeof(PackedVector));
+        memcpy(clip.scales.data(), file.data + file_clip.keys_offset[AnimationClip::Scale], clip.scales.size() * sizeof(PackedVector));
+    }
+
+    key = header.key;
+    meshes.resize(header.mesh_count);
+    for (uint32_t i = 0; i < header.mesh_count; ++i)
+    {
+        FileMesh file_mesh;
+        memcpy(&file_mesh, file.data + sizeof(FileHeader) + i * sizeof(FileMesh), sizeof(file_mesh));
+
+        if ((file_mesh.index_size != 2 && file_mesh.index_size != 4)
+            || !in_file(file_mesh.vertex_offset, uint64_t(file_mesh.vertex_count) * vertex_stride)
+            || !in_file(file_mesh.index_offset, uint64_t(file_mesh.index_count) * file_mesh.index_size)
+            || !in_file(file_mesh.texture_name_offset, file_mesh.texture_name_length)
+            || (file_mesh.influence_offset && (skeleton.empty() || !in_file(file_mesh.influence_offset, uint64_t(file_mesh.vertex_count) * sizeof(SkinInfluence)))))
+            return fail();
+
+        const uint8_t* indices = file.data + file_mesh.index_offset;
+        if (file_mesh.index_size == 2 ? !indicesInRange<uint16_t>(indices, file_mesh.index_count, file_mesh.vertex_count) : !indicesInRange<uint32_t>(indices, file_mesh.index_count, file_mesh.vertex_count))
+            return fail();
+        if (file_mesh.influence_offset && !influencesInRange(file.data + file_mesh.influence_offset, file_mesh.vertex_count, skeleton.jointCount()))
+            return fail();
+
+        CachedMesh& mesh = meshes[i];
+        mesh.vertex_count = file_mesh.vertex_count;
+        mesh.index_count = file_mesh.index_count;
+        mesh.index_size = file_mesh.index_size;
+        mesh.vertices = file.data + file_mesh.vertex_offset;
+        mesh.indices = file.data + file_mesh.index_offset;
+        mesh.influences = file_mesh.influence_offset ? reinterpret_cast<const SkinInfluence*>(file.data + file_mesh.influence_offset) : nullptr;
+        mesh.texture_name.assign(reinterpret_cast<const char*>(file.data + file_mesh.texture_name_offset), file_mesh.texture_name_length);
+        mesh.bounds_min = glm::vec3(file_mesh.bounds_min[0], file_mesh.bounds_min[1], file_mesh.bounds_min[2]);
+        mesh.bounds_max = glm::vec3(file_mesh.bounds_max[0], file_mesh.bounds_max[1], file_mesh.bounds_max[2]);
+    }
+
+    return true;
+}
+
+void MeshCache::close()
+{
+    meshes.clear();
+    skeleton = {};
+    file.close();
+}
+
+bool MeshCache::write(const std::string& path, uint64_t key, uint32_t vertex_stride, const std::vector<CachedMesh>& meshes, const Skeleton& skeleton)
+{
+    FileHeader header{};
+    memcpy(header.magic, magic, sizeof(magic));
+    header.version = version;
+    header.key = key;
+    header.vertex_stride = vertex_stride;
+    header.mesh_count = static_cast<uint32_t>(meshes.size());
+    header.joint_count = skeleton.jointCount();
+    header.clip_count = static_cast<uint32_t>(skeleton.clips.size());
+
+    // lay out the blobs after the mesh table and skeleton, each one aligned so the mapped data can be read in place
+    std::vector<FileMesh> file_meshes(meshes.size());
+    uint64_t offset = sizeof(FileHeader) + meshes.size() * sizeof(FileMesh);
+
+    header.skeleton_offset = offset;
+    std::vector<FileJoint> file_joints(skeleton.jointCount());
+    offset += file_joints.size() * sizeof(FileJoint);
+    for (uint32_t i = 0; i < skeleton.jointCount(); ++i)
+    {
+        FileJoint& file_joint = file_joints[i];
+        file_joint.parent = skeleton.parents[i];
+        file_joint.name_length = static_cast<uint32_t>(skeleton.names[i].size());
+        file_joint.name_offset = offset;
+        memcpy(file_joint.bind_local, &skeleton.bind_locals[i][0][0], sizeof(file_joint.bind_local));
+        memcpy(file_joint.inverse_bind, &skeleton.inverse_binds[i][0][0], sizeof(file_joint.inverse_bind));
+        offset += skeleton.names[i].size();
+    }
+
+    // clips hold their keys copied out on load, so only the tables need aligning
+    offset = alignUp(offset, blob_alignment);
+    header.clips_offset = offset;
+    std::vector<FileClip> file_clips(skeleton.clips.size());
+    offset += file_clips.size() * sizeof(FileClip);
+    for (size_t i = 0; i < skeleton.clips.size(); ++i)
+    {
+        const AnimationClip& clip = skeleton.clips[i];
+        FileClip& file_clip = file_clips[i];
+
+        file_clip.name_length = static_cast<uint32_t>(clip.name.size());
+        file_clip.joint_count = clip.joint_count;
+        file_clip.duration = clip.duration;
+        file_clip.name_offset = offset;
+        offset += clip.name.size();
+
+        offset = alignUp(offset, blob_alignment);
+        file_clip.tracks_offset = offset;
+        offset += size_t(clip.joint_count) * AnimationClip::channel_count * sizeof(FileTrack);
+
+        for (uint32_t channel = 0; channel < AnimationClip::channel_count; ++channel)
+        {
+            file_clip.key_counts[channel] = static_cast<uint32_t>(clip.times[channel].size());
+
+            file_clip.times_offset[channel] = offset;
+            offset += clip.times[channel].size() * sizeof(uint16_t);
+
+            file_clip.keys_offset[channel] = offset;
+            offset += clip.times[channel].size() * (channel == AnimationClip::Rotation ? sizeof(PackedRotation) : sizeof(PackedVector));
+        }
+    }
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        const CachedMesh& mesh = meshes[i];
+        FileMesh& file_mesh = file_meshes[i];
+
+        file_mesh.vertex_count = mesh.vertex_count;
+        file_mesh.index_count = mesh.index_count;
+        file_mesh.index_size = mesh.index_size;
+        file_mesh.texture_name_length = static_cast<uint32_t>(mesh.texture_name.size());
+        memcpy(file_mesh.bounds_min, &mesh.bounds_min.x, sizeof(file_mesh.bounds_min));
+        memcpy(file_mesh.bounds_max, &mesh.bounds_max.x, sizeof(file_mesh.bounds_max));
+
+        offset = alignUp(offset, blob_alignment);
+        file_mesh.vertex_offset = offset;
+        offset += uint64_t(mesh.vertex_count) * vertex_stride;
+
+        offset = alignUp(offset, blob_alignment);
+        file_mesh.index_offset = offset;
+        offset += uint64_t(mesh.index_count) * mesh.index_size;
+
+        file_mesh.influence_offset = 0;
+        if (mesh.influences)
+        {
+            offset = alignUp(offset, blob_alignment);
+            file_mesh.influence_offset = offset;
+            offset += uint64_t(mesh.vertex_count) * sizeof(SkinInfluence);
+        }
+
+        file_mesh.texture_name_offset = offset;
+        offset += mesh.texture_name.size();
+    }
+
+    std::vector<unsigned char> contents(offset, 0);
+    memcpy(contents.data(), &header, sizeof(header));
+    if (!file_meshes.empty())
+        memcpy(contents.data() + sizeof(FileHeader), file_meshes.data(), file_meshes.size() * sizeof(FileMesh));
+    if (!file_joints.empty())
+        memcpy(contents.data() + header.skeleton_offset, file_joints.data(), file_joints.size() * sizeof(FileJoint));
+    for (uint32_t i = 0; i < skeleton.jointCount(); ++i)
+        memcpy(contents.data() + file_joints[i].name_offset, skeleton.names[i].data(), skeleton.names[i].size());
+
+    if (!file_clips.empty())
+        memcpy(contents.data() + header.clips_offset, file_clips.data(), file_clips.size() * sizeof(FileClip));
+    for (size_t i = 0; i < skeleton.clips.size(); ++i)
+    {
+        const AnimationClip& clip = skeleton.clips[i];
+        const FileClip& file_clip = file_clips[i];
+
+        memcpy(contents.data() + file_clip.name_offset, clip.name.data(), clip.name.size());
+
+        for (uint32_t channel = 0; channel < AnimationClip::channel_count; ++channel)
+        {
+            for (uint32_t j = 0; j < clip.joint_count; ++j)
+            {
+                const AnimationTrack& track = clip.tracks[channel][j];
+                FileTrack file_track{ track.first_key, track.key_count };
+                memcpy(file_track.range_min, &track.range_min.x, sizeof(file_track.range_min));
+                memcpy(file_track.range_extent, &track.range_extent.x, sizeof(file_track.range_extent));
+                memcpy(contents.data() + file_clip.tracks_offset + (size_t(channel) * clip.joint_count + j) * sizeof(FileTrack), &file_track, sizeof(file_track));
+            }
+
+            if (!clip.times[channel].empty())
+                memcpy(contents.data() + file_clip.times_offset[channel], clip.times[channel].data(), clip.times[channel].size() * sizeof(uint16_t));
+        }
+
+        if (!clip.rotations.empty())
+            memcpy(contents.data() + file_clip.keys_offset[AnimationClip::Rotation], clip.rotations.data(), clip.rotations.size() * sizeof(PackedRotation));
+        if (!clip.translations.empty())
+            memcpy(contents.data() + file_clip.keys_offset[AnimationClip::Translation], clip.translations.data(), clip.translations.size() * sizeof(PackedVector));
+        if (!clip.scales.empty())
+            memcpy(contents.data() + file_clip.keys_offset[AnimationClip::Scale], clip.scales.data(), clip.scales.size() * sizeof(PackedVector));
+    }
+
+    for (size_t i = 0; i < meshes.size(); ++i)
+    {
+        const CachedMesh& mesh = meshes[i];
+        const FileMesh& file_mesh = file_meshes[i];
+
+        if (mesh.vertex_count)
+            memcpy(contents.data() + file_mesh.vertex_offset, mesh.vertices, size_t(mesh.vertex_count) * vertex_stride);
+        if (mesh.index_count)
+            memcpy(contents.data() + file_mesh.index_offset, mesh.indices, size_t(mesh.index_count) * mesh.index_size);
+        if (mesh.influences)
+            memcpy(contents.data() + file_mesh.influence_offset, mesh.influences, size_t(mesh.vertex_count) * sizeof(SkinInfluence));
+        if (!mesh.texture_name.empty())
+            memcpy(contents.data() + file_mesh.texture_name_offset, mesh.texture_name.data(), mesh.texture_name.size());
+    }
+
+    if (!writeFileAtomic(path, contents.data(), contents.size()))
+    {
+        log_warning(("failed to write mesh cache " + path + "\n").c_str());
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "AssetFile.h"
+#include "Skeleton.h"
+
+#include "glm/glm.hpp"
+
+#include <string>
+#include <vector>
+
+// One mesh in its final GPU layout. For a loaded cache the pointers point into the mapped file,
+// when cooking they point at the freshly imported arrays
+struct CachedMesh
+{
+    uint32_t vertex_count = 0;
+    uint32_t index_count = 0;
+    uint32_t index_size = 0; // 2 or 4 bytes
+
+    const void* vertices = nullptr;
+    const void* indices = nullptr;
+    const SkinInfluence* influences = nullptr; // one per vertex for skinned meshes, indexing the cache's skeleton
+
+    std::string texture_name; // relative to the model's directory, empty if untextured
+
+    glm::vec3 bounds_min = glm::vec3(0.0f);
+    glm::vec3 bounds_max = glm::vec3(0.0f);
+};
+
+// A model cooked by the asset cooker. On load the format version and vertex stride are checked, along with every
+// offset, index and joint reference, so a damaged file fails to open rather than sending the GPU out of bounds.
+// Whether the contents are current is the cooker's business (key is the content hash it was cooked from).
+// Skinned models carry one skeleton shared by all of their skinned meshes, along with the model's animation clips
+struct MeshCache
+{
+    static constexpr uint32_t version = 3;
+
+    MappedFile file;
+    uint64_t key = 0;
+    std::vector<CachedMesh> meshes;
+    Skeleton skeleton; // copied out of the file, empty for static models
+
+    bool open(const std::string& path, uint32_t vertex_stride);
+    void close();
+
+    static bool write(const std::string& path, uint64_t key, uint32_t vertex_stride, const std::vector<CachedMesh>& meshes, const Skeleton& skeleton);
+};
@@ -0,0 +1,381 @@
+#include "MeshOptimizer.h"
+
+#include <vector>
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+namespace
+{
+    // Forsyth's scoring constants, the scoring cache is larger than the simulated one on purpose
+    constexpr int score_cache_size = 32;
+    constexpr float cache_decay_power = 1.5f;
+    constexpr float last_triangle_score = 0.75f;
+    constexpr float valence_boost_scale = 2.0f;
+    constexpr float valence_boost_power = 0.5f;
+
+    float vertexScore(int cache_position, uint32_t remaining_triangles)
+    {
+        // no triangles left to emit, the vertex is of no use any more
+        if (remaining_triangles == 0)
+            return -1.0f;
+
+        float score = 0.0f;
+        if (cache_position >= 0)
+        {
+            // the last triangle's vertices get a fixed score so the next triangle does not reuse them all
+            if (cache_position < 3)
+                score = last_triangle_score;
+            else
+                score = std::pow(1.0f - (cache_position - 3) / float(score_cache_size - 3), cache_decay_power);
+        }
+
+        // boost vertices with few triangles left, finishing them frees cache slots
+        score += valence_boost_scale * std::pow(float(remaining_triangles), -valence_boost_power);
+        return score;
+    }
+
+    // FIFO cache where each entry remembers when it was inserted
+    struct CacheSimulator
+    {
+        std::vector<uint32_t> timestamps;
+        uint32_t time;
+        uint32_t cache_size;
+
+        CacheSimulator(size_t vertex_count, uint32_t cache_size) : timestamps(vertex_count, 0), time(cache_size + 1), cache_size(cache_size) {}
+
+        void reset() { time += cache_size + 1; }
+
+        // returns the number of misses for the triangle
+        uint32_t triangle(const uint32_t* corners)
+        {
+            uint32_t misses = 0;
+            for (int k = 0; k < 3; ++k)
+            {
+                if (time - timestamps[corners[k]] > cache_size)
+                {
+                    timestamps[corners[k]] = time++;
+                    ++misses;
+                }
+            }
+            return misses;
+        }
+    };
+}
+
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t index_count, size_t vertex_count, uint32_t cache_size)
+{
+    VertexCacheStats stats{};
+    if (index_count == 0)
+        return stats;
+
+    CacheSimulator cache(vertex_count, cache_size);
+    std::vector<bool> referenced(vertex_count, false);
+
+    size_t transformed = 0;
+    size_t unique = 0;
+    for (size_t i = 0; i < index_count; i += 3)
+    {
+        transformed += cache.triangle(&indices[i]);
+
+        for (int k = 0; k < 3; ++k)
+        {
+            if (!referenced[indices[i + k]])
+            {
+                referenced[indices[i + k]] = true;
+                ++unique;
+            }
+        }
+    }
+
+    stats.acmr = float(transformed) / float(index_count / 3);
+    stats.atvr = float(transformed) / float(unique);
+    return stats;
+}
+
+void optimizeVertexCache(uint32_t* indices, size_t index_count, size_t vertex_count)
+{
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count == 0)
+        return;
+
+    // triangles adjacent to each vertex, the first remaining[v] entries are the ones not yet emitted
+    std::vector<uint32_t> remaining(vertex_count, 0);
+    for (size_t i = 0; i < index_count; ++i)
+        ++remaining[indices[i]];
+
+    std::vector<uint32_t> adjacency_offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; ++v)
+        adjacency_offsets[v + 1] = adjacency_offsets[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(index_count);
+    {
+        std::vector<uint32_t> fill(adjacency_offsets.begin(), adjacency_offsets.end() - 1);
+        for (size_t i = 0; i < index_count; ++i)
+            adjacency[fill[indices[i]]++] = uint32_t(i / 3);
+    }
+
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> vertex_score(vertex_count);
+    for (size_t v = 0; v < vertex_count; ++v)
+        vertex_score[v] = vertexScore(-1, remaining[v]);
+
+    std::vector<float> triangle_score(triangle_count);
+    for (size_t t = 0; t < triangle_count; ++t)
+        triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+
+    std::vector<bool> emitted(triangle_count, false);
+    std::vector<uint32_t> output;
+    output.reserve(index_count);
+
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> next_cache;
+    cache.reserve(score_cache_size + 3);
+    next_cache.reserve(score_cache_size + 3);
+
+    size_t best = std::max_element(triangle_score.begin(), triangle_score.end()) - triangle_score.begin();
+    size_t scan_cursor = 0;
+
+    while (true)
+    {
+        const uint32_t* corners = &indices[best * 3];
+        output.insert(output.end(), corners, corners + 3);
+        emitted[best] = true;
+
+        // retire the triangle from its vertices' adjacency
+        for (int k = 0; k < 3; ++k)
+        {
+            const uint32_t v = corners[k];
+            uint32_t* begin = &adjacency[adjacency_offsets[v]];
+            uint32_t* end = begin + remaining[v];
+            *std::find(begin, end, uint32_t(best)) = *(end - 1);
+            --remaining[v];
+        }
+
+        // the emitted vertices move to the front of the LRU cache
+        next_cache.clear();
+        for (int k = 0; k < 3; ++k)
+        {
+            if (std::find(next_cache.begin(), next_cache.end(), corners[k]) == next_cache.end())
+                next_cache.push_back(corners[k]);
+        }
+        for (uint32_t v : cache)
+        {
+            if (v != corners[0] && v != corners[1] && v != corners[2])
+                next_cache.push_back(v);
+        }
+
+        // anything pushed out of the cache gets its score updated too
+        for (size_t i = 0; i < next_cache.size(); ++i)
+        {
+            const uint32_t v = next_cache[i];
+            cache_position[v] = i < size_t(score_cache_size) ? int(i) : -1;
+
+            const float score = vertexScore(cache_position[v], remaining[v]);
+            const float delta = score - vertex_score[v];
+            vertex_score[v] = score;
+
+            for (uint32_t a = 0; a < remaining[v]; ++a)
+                triangle_score[adjacency[adjacency_offsets[v] + a]] += delta;
+        }
+
+        if (next_cache.size() > size_t(score_cache_size))
+            next_cache.resize(score_cache_size);
+        std::swap(cache, next_cache);
+
+        // the best next triangle is almost always one using a cached vertex
+        float best_score = -1.0f;
+        bool found = false;
+        for (uint32_t v : cache)
+        {
+            for (uint32_t a = 0; a < remaining[v]; ++a)
+            {
+                const uint32_t t = adjacency[adjacency_offsets[v] + a];
+                if (triangle_score[t] > best_score)
+                {
+                    best_score = triangle_score[t];
+                    best = t;
+                    found = true;
+                }
+            }
+        }
+
+        if (!found)
+        {
+            // disconnected from everything cached, continue with the next unemitted triangle
+            while (scan_cursor < triangle_count && emitted[scan_cursor])
+                ++scan_cursor;
+
+            if (scan_cursor == triangle_count)
+                break;
+
+            best = scan_cursor;
+        }
+    }
+
+    memcpy(indices, output.data(), index_count * sizeof(uint32_t));
+}
+
+void optimizeOverdraw(uint32_t* indices, size_t index_count, const float* positions, size_t vertex_count, size_t position_stride, float threshold)
+{
+    const size_t triangle_count = index_count / 3;
+    if (triangle_count == 0)
+        return;
+
+    constexpr uint32_t cache_size = 16;
+
+    // hard boundaries: triangles where the vertex cache optimiser had to start afresh
+    std::vector<size_t> hard_boundaries;
+    {
+        CacheSimulator cache(vertex_count, cache_size);
+        for (size_t t = 0; t < triangle_count; ++t)
+        {
+            if (cache.triangle(&indices[t * 3]) == 3 || t == 0)
+                hard_boundaries.push_back(t);
+        }
+        hard_boundaries.push_back(triangle_count);
+    }
+
+    // soft boundaries: split hard clusters further as long as the ACMR stays within threshold of the cluster's own
+    std::vector<size_t> boundaries;
+    {
+        CacheSimulator cache(vertex_count, cache_size);
+        for (size_t c = 0; c + 1 < hard_boundaries.size(); ++c)
+        {
+            const size_t start = hard_boundaries[c];
+            const size_t end = hard_boundaries[c + 1];
+
+            cache.reset();
+            uint32_t cluster_misses = 0;
+            for (size_t t = start; t < end; ++t)
+                cluster_misses += cache.triangle(&indices[t * 3]);
+            const float cluster_threshold = threshold * float(cluster_misses) / float(end - start);
+
+            cache.reset();
+            boundaries.push_back(start);
+
+            uint32_t running_misses = 0;
+            uint32_t running_triangles = 0;
+            for (size_t t = start; t < end; ++t)
+            {
+                running_misses += cache.triangle(&indices[t * 3]);
+                ++running_triangles;
+
+                if (t + 1 < end && float(running_misses) / float(running_triangles) <= cluster_threshold)
+                {
+                    boundaries.push_back(t + 1);
+                    cache.reset();
+                    running_misses = 0;
+                    running_triangles = 0;
+                }
+            }
+        }
+        boundaries.push_back(triangle_count);
+    }
+
+    auto position = [&](uint32_t v)
+    {
+        return reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + v * position_stride);
+    };
+
+    // area weighted centroid of the whole mesh
+    float mesh_centroid[3] = {};
+    float mesh_area = 0.0f;
+
+    struct Cluster
+    {
+        size_t start;
+        size_t end;
+        float centroid[3];
+        float normal[3];
+        float sort_key;
+    };
+    std::vector<Cluster> clusters(boundaries.size() - 1);
+
+    for (size_t c = 0; c < clusters.size(); ++c)
+    {
+        Cluster& cluster = clusters[c];
+        cluster = Cluster{};
+        cluster.start = boundaries[c];
+        cluster.end = boundaries[c + 1];
+
+        float area = 0.0f;
+        for (size_t t = cluster.start; t < cluster.end; ++t)
+        {
+            const float* a = position(indices[t * 3]);
+            const float* b = position(indices[t * 3 + 1]);
+            const float* c0 = position(indices[t * 3 + 2]);
+
+            const float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+            const float e2[3] = { c0[0] - a[0], c0[1] - a[1], c0[2] - a[2] };
+            const float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            const float triangle_area = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+            for (int k = 0; k < 3; ++k)
+            {
+                cluster.centroid[k] += (a[k] + b[k] + c0[k]) / 3.0f * triangle_area;
+                cluster.normal[k] += n[k];
+            }
+            area += triangle_area;
+        }
+
+        for (int k = 0; k < 3; ++k)
+            mesh_centroid[k] += cluster.centroid[k];
+        mesh_area += area;
+
+        const float inv_area = area > 0.0f ? 1.0f / area : 0.0f;
+        for (int k = 0; k < 3; ++k)
+            cluster.centroid[k] *= inv_area;
+
+        const float normal_length = std::sqrt(cluster.normal[0] * cluster.normal[0] + cluster.normal[1] * cluster.normal[1] + cluster.normal[2] * cluster.normal[2]);
+        const float inv_normal_length = normal_length > 0.0f ? 1.0f / normal_length : 0.0f;
+        for (int k = 0; k < 3; ++k)
+            cluster.normal[k] *= inv_normal_length;
+    }
+
+    const float inv_mesh_area = mesh_area > 0.0f ? 1.0f / mesh_area : 0.0f;
+    for (int k = 0; k < 3; ++k)
+        mesh_centroid[k] *= inv_mesh_area;
+
+    // clusters far out along their own normal are likely to occlude the rest from most view directions
+    for (auto& cluster : clusters)
+    {
+        cluster.sort_key = 0.0f;
+        for (int k = 0; k < 3; ++k)
+            cluster.sort_key += (cluster.centroid[k] - mesh_centroid[k]) * cluster.normal[k];
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.sort_key > b.sort_key; });
+
+    std::vector<uint32_t> output;
+    output.reserve(index_count);
+    for (const auto& cluster : clusters)
+        output.insert(output.end(), indices + cluster.start * 3, indices + cluster.end * 3);
+
+    memcpy(indices, output.data(), index_count * sizeof(uint32_t));
+}
+
+size_t optimizeVertexFetch(void* vertices, size_t vertex_count, size_t vertex_size, uint32_t* indices, size_t index_count)
+{
+    std::vector<uint32_t> remap(vertex_count, UINT32_MAX);
+    uint32_t next_vertex = 0;
+
+    for (size_t i = 0; i < index_count; ++i)
+    {
+        uint32_t& new_index = remap[indices[i]];
+        if (new_index == UINT32_MAX)
+            new_index = next_vertex++;
+
+        indices[i] = new_index;
+    }
+
+    std::vector<char> reordered(size_t(next_vertex) * vertex_size);
+    for (size_t v = 0; v < vertex_count; ++v)
+    {
+        if (remap[v] != UINT32_MAX)
+            memcpy(&reordered[remap[v] * vertex_size], static_cast<const char*>(vertices) + v * vertex_size, vertex_size);
+    }
+
+    memcpy(vertices, reordered.data(), reordered.size());
+    return next_vertex;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// Triangle list optimisations run on imported meshes before upload. All of them work on 32 bit indices in place.
+
+struct VertexCacheStats
+{
+    float acmr; // average cache miss ratio, transformed vertices per triangle (0.5 is ideal for large grids, 3 is worst)
+    float atvr; // average transformed vertex ratio, transformed vertices per unique vertex (1 is ideal)
+};
+
+struct MeshOptimizeSettings
+{
+    bool vertex_cache = true;
+    bool overdraw = true;
+    float overdraw_threshold = 1.05f; // how much the ACMR may grow to allow reordering clusters for overdraw
+    bool vertex_fetch = true;
+
+    bool print_stats = false;
+};
+
+// simulates a FIFO post-transform cache of cache_size entries
+VertexCacheStats analyzeVertexCache(const uint32_t* indices, size_t index_count, size_t vertex_count, uint32_t cache_size = 16);
+
+// reorders triangles for the post-transform vertex cache (Forsyth's linear speed algorithm)
+void optimizeVertexCache(uint32_t* indices, size_t index_count, size_t vertex_count);
+
+// reorders clusters of triangles so outward facing, outer parts of the mesh are drawn first (Sander et al. 2007),
+// run after optimizeVertexCache as clusters are split along its cache flushes
+void optimizeOverdraw(uint32_t* indices, size_t index_count, const float* positions, size_t vertex_count, size_t position_stride, float threshold);
+
+// reorders vertices in the order the index buffer first uses them and drops unused vertices, returns the new vertex count
+size_t optimizeVertexFetch(void* vertices, size_t vertex_count, size_t vertex_size, uint32_t* indices, size_t index_count);
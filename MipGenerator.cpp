@@ -0,0 +1,129 @@
+#include "MipGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MIP_GENERATOR_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace
+{
+    constexpr uint32_t encode_lut_size = 4096; // 12 bit linear keeps every step below one 8 bit sRGB step
+
+    struct SrgbTables
+    {
+        float decode[256];
+        unsigned char encode[encode_lut_size];
+
+        SrgbTables()
+        {
+            for (uint32_t i = 0; i < 256; ++i)
+            {
+                const float c = i / 255.0f;
+                decode[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+
+            for (uint32_t i = 0; i < encode_lut_size; ++i)
+            {
+                const float l = i / float(encode_lut_size - 1);
+                const float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+                encode[i] = static_cast<unsigned char>(std::min(255.0f, c * 255.0f + 0.5f));
+            }
+        }
+    };
+
+    const SrgbTables& srgbTables()
+    {
+        static const SrgbTables tables;
+        return tables;
+    }
+
+    // one row as linear RGBA floats, alpha normalised
+    void decodeRow(const unsigned char* src, uint32_t width, float* dst)
+    {
+        const SrgbTables& tables = srgbTables();
+        for (uint32_t x = 0; x < width; ++x)
+        {
+            dst[x * 4 + 0] = tables.decode[src[x * 4 + 0]];
+            dst[x * 4 + 1] = tables.decode[src[x * 4 + 1]];
+            dst[x * 4 + 2] = tables.decode[src[x * 4 + 2]];
+            dst[x * 4 + 3] = src[x * 4 + 3] * (1.0f / 255.0f);
+        }
+    }
+}
+
+uint32_t mipLevelCount(uint32_t width, uint32_t height)
+{
+    uint32_t levels = 1;
+    while (std::max(width, height) >> levels)
+        ++levels;
+    return levels;
+}
+
+size_t mipChainSize(uint32_t width, uint32_t height, uint32_t level_count)
+{
+    size_t size = 0;
+    for (uint32_t level = 0; level < level_count; ++level)
+        size += size_t(std::max(1u, width >> level)) * std::max(1u, height >> level) * 4;
+    return size;
+}
+
+void downsampleSrgb(const unsigned char* src, uint32_t src_width, uint32_t src_height, unsigned char* dst)
+{
+    const SrgbTables& tables = srgbTables();
+    const uint32_t dst_width = std::max(1u, src_width / 2);
+    const uint32_t dst_height = std::max(1u, src_height / 2);
+
+    std::vector<float> rows(size_t(src_width) * 4 * 2);
+    float* row0 = rows.data();
+    float* row1 = rows.data() + size_t(src_width) * 4;
+
+    for (uint32_t y = 0; y < dst_height; ++y)
+    {
+        // 1 pixel wide or high sources repeat their only row/column
+        const uint32_t y0 = std::min(y * 2, src_height - 1);
+        const uint32_t y1 = std::min(y * 2 + 1, src_height - 1);
+        decodeRow(src + size_t(y0) * src_width * 4, src_width, row0);
+        decodeRow(src + size_t(y1) * src_width * 4, src_width, row1);
+
+        unsigned char* out = dst + size_t(y) * dst_width * 4;
+        for (uint32_t x = 0; x < dst_width; ++x)
+        {
+            const size_t x0 = size_t(std::min(x * 2, src_width - 1)) * 4;
+            const size_t x1 = size_t(std::min(x * 2 + 1, src_width - 1)) * 4;
+
+            int32_t quantised[4];
+#ifdef MIP_GENERATOR_SSE2
+            // a whole RGBA pixel per register
+            __m128 sum = _mm_add_ps(_mm_add_ps(_mm_loadu_ps(row0 + x0), _mm_loadu_ps(row0 + x1)), _mm_add_ps(_mm_loadu_ps(row1 + x0), _mm_loadu_ps(row1 + x1)));
+            const __m128 scale = _mm_set_ps(255.0f * 0.25f, (encode_lut_size - 1) * 0.25f, (encode_lut_size - 1) * 0.25f, (encode_lut_size - 1) * 0.25f);
+            sum = _mm_min_ps(_mm_max_ps(_mm_mul_ps(sum, scale), _mm_setzero_ps()), _mm_set_ps(255.0f, encode_lut_size - 1.0f, encode_lut_size - 1.0f, encode_lut_size - 1.0f));
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(quantised), _mm_cvtps_epi32(sum));
+#else
+            for (uint32_t c = 0; c < 4; ++c)
+            {
+                const float average = (row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c]) * 0.25f;
+                const float limit = c == 3 ? 255.0f : encode_lut_size - 1.0f;
+                quantised[c] = static_cast<int32_t>(std::min(limit, std::max(0.0f, average * limit)) + 0.5f);
+            }
+#endif
+            out[x * 4 + 0] = tables.encode[quantised[0]];
+            out[x * 4 + 1] = tables.encode[quantised[1]];
+            out[x * 4 + 2] = tables.encode[quantised[2]];
+            out[x * 4 + 3] = static_cast<unsigned char>(quantised[3]);
+        }
+    }
+}
+
+void generateMipChain(unsigned char* pixels, uint32_t width, uint32_t height, uint32_t first_level, uint32_t level_count)
+{
+    for (uint32_t level = std::max(1u, first_level); level < level_count; ++level)
+    {
+        unsigned char* src = pixels + mipChainSize(width, height, level - 1);
+        unsigned char* dst = pixels + mipChainSize(width, height, level);
+        downsampleSrgb(src, std::max(1u, width >> (level - 1)), std::max(1u, height >> (level - 1)), dst);
+    }
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+
+// CPU mipmap generation for RGBA8 sRGB images. A mip chain is stored tightly packed, level 0 first,
+// each level max(1, size / 2) of the previous one in both dimensions.
+
+// levels in a full chain down to 1x1
+uint32_t mipLevelCount(uint32_t width, uint32_t height);
+
+// bytes taken by levels [0, level_count)
+size_t mipChainSize(uint32_t width, uint32_t height, uint32_t level_count);
+
+// 2x2 box filter of one level into the next. Colour is averaged in linear space, alpha as is.
+// Uses SSE2 where available
+void downsampleSrgb(const unsigned char* src, uint32_t src_width, uint32_t src_height, unsigned char* dst);
+
+// fills levels [first_level, level_count) of the chain in pixels, each from the level before it
+void generateMipChain(unsigned char* pixels, uint32_t width, uint32_t height, uint32_t first_level, uint32_t level_count);
@@ -1,88 +1,147 @@
-
 #include "ModelLoader.h"
 
 #include "VulkanWrapper/Log.h"
 #include "VulkanWrapper/Image.h"
-#include "VulkanWrapper/Buffer.h"
+#include "VulkanWrapper/UploadBatch.h"
+#include "MeshCache.h"
+#include "CookedTexture.h"
+#include "VulkanWrapper/TextureCache.h"
 
-#include "assimp/Importer.hpp"
-#include "assimp/postprocess.h"
-#include "assimp/scene.h"
+#include <algorithm>
 
-inline glm::vec3 transform_by_matrix(const glm::vec3& v, const glm::mat4& m, bool is_position = true)
+static std::string directoryOf(const std::string& file_path)
 {
-	return glm::vec3(m * glm::vec4(v, is_position ? 1.0 : 0.0));
+	auto index = file_path.find_last_of("/\\");
+	return file_path.substr(0, index + 1);
 }
 
-void addMesh(aiMesh* mesh, std::vector<Vertex>& verts, const glm::mat4& bake_transform)
+// textures are cooked next to the model they came with, mirroring the source tree
+static std::string cookedTexturePath(const std::string& model_path, const std::string& texture_name)
 {
-	std::vector<unsigned int> indices;
-	for (unsigned int i = 0; i < mesh->mNumFaces; i++)
-	{
-		const auto& face = mesh->mFaces[i];
-		for (unsigned int j = 0; j < face.mNumIndices; j++)
-			indices.push_back(face.mIndices[j]);
-	}
+	return texture_name.empty() ? std::string() : directoryOf(model_path) + texture_name + ".ktx2";
+}
+
+UploadToken loadModels(const std::vector<ModelRequest>& models, std::vector<Mesh>& meshes, std::vector<Skeleton>& skeletons, GeometryPool& geometry_pool, TextureCache& texture_cache, DeviceManager& device_manager, ThreadPool& thread_pool, TextureStreamer* texture_streamer)
+{
+	std::vector<MeshCache> caches(models.size());
 
-	for (auto x = 0; x < indices.size(); x++)
+	// mapping is cheap, but the page faults it leads to are not, so files are opened and touched in parallel
+	thread_pool.parallelFor(models.size(), [&](size_t i, uint32_t thread_index)
+	{
+		if (!caches[i].open(models[i].file_path, sizeof(Vertex)))
+			log_warning(("failed to load cooked model " + models[i].file_path + ", run asset_cooker\n").c_str());
+	});
+
+	// one canonical path per mesh, the empty path stands for untextured
+	std::vector<std::vector<std::string>> mesh_texture_paths(models.size());
+	std::vector<std::string> texture_paths; // not cached yet, each loaded once however many meshes use it
+	for (size_t i = 0; i < models.size(); ++i)
 	{
-		int i = indices[x];
+		for (const auto& cached_mesh : caches[i].meshes)
+		{
+			const std::string texture_path = TextureCache::canonicalPath(cookedTexturePath(models[i].file_path, cached_mesh.texture_name));
+			mesh_texture_paths[i].push_back(texture_path);
 
-		Vertex vert{};
+			if (!texture_path.empty() && !texture_cache.entries.count(texture_path) && std::find(texture_paths.begin(), texture_paths.end(), texture_path) == texture_paths.end())
+				texture_paths.push_back(texture_path);
+		}
+	}
 
-		vert.pos = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+	std::vector<CookedTexture> textures(texture_paths.size());
+	thread_pool.parallelFor(texture_paths.size(), [&](size_t i, uint32_t thread_index)
+	{
+		if (!textures[i].open(texture_paths[i]))
+			log_warning(("failed to load cooked texture " + texture_paths[i] + "\n").c_str());
+	});
 
-		vert.texCoord = glm::vec2(0.0f, 0.0f);
-		if (mesh->mTextureCoords[0])
-			vert.texCoord = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+	// only the GPU side runs on this thread, everything is copied from the mapped files into one submission
+	UploadBatch upload_batch;
+	upload_batch.begin(device_manager);
 
-		vert.pos = transform_by_matrix(vert.pos, bake_transform, true);
+	std::vector<Texture*> added_textures;
+	auto getTexture = [&](std::string texture_path) -> Texture*
+	{
+		CookedTexture* cooked = nullptr;
+		if (!texture_path.empty() && !texture_cache.entries.count(texture_path))
+		{
+			cooked = &textures[std::find(texture_paths.begin(), texture_paths.end(), texture_path) - texture_paths.begin()];
+			if (!cooked->level_count)
+				texture_path.clear();
+		}
 
-		verts.push_back(vert);
-	}
-}
+		if (Texture* texture = texture_cache.acquire(texture_path))
+			return texture;
+
+		// untextured meshes and missing textures share a single white texel
+		static const unsigned char white_texel[4] = { 255, 255, 255, 255 };
+		TextureData texture_data{};
+		texture_data.width = 1;
+		texture_data.height = 1;
+		texture_data.levels[0] = { white_texel, sizeof(white_texel) };
+		// streamed textures start out with just their mip tail, the streamer brings in the rest
+		uint32_t first_level = 0;
+		if (!texture_path.empty())
+		{
+			if (texture_streamer)
+				first_level = texture_streamer->tailLevel(*cooked);
+
+			texture_data.width = std::max(1u, cooked->width >> first_level);
+			texture_data.height = std::max(1u, cooked->height >> first_level);
+			texture_data.format = cooked->format;
+			texture_data.level_count = cooked->level_count - first_level;
+			for (uint32_t level = first_level; level < cooked->level_count; ++level)
+				texture_data.levels[level - first_level] = { cooked->levels[level].data, cooked->levels[level].size };
+		}
 
-void loadModel(const std::string& file_path, const glm::mat4& bake_transform, std::vector<Mesh>& meshes, DeviceManager& device_manager)
-{
-	auto index = file_path.find_last_of("/\\");
-	std::string texture_directory = file_path.substr(0, index + 1);
+		Texture* texture = texture_cache.add(device_manager, upload_batch, texture_path, texture_data);
+		added_textures.push_back(texture);
 
-	Assimp::Importer importer;
-	const aiScene* scene = importer.ReadFile(file_path, aiProcess_Triangulate | aiProcess_FlipUVs | aiProcess_CalcTangentSpace | aiProcess_GenSmoothNormals);
+		if (first_level > 0)
+			texture_streamer->add(device_manager, texture, *cooked);
+		return texture;
+	};
 
-	if (!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode)
-	{
-		log_error(importer.GetErrorString());
-		return;
-	}
+	const size_t first_mesh = meshes.size();
 
-	for (unsigned int i = 0; i < scene->mNumMeshes; i++)
+	for (size_t i = 0; i < models.size(); ++i)
 	{
-		std::vector<Vertex> verts;
-		addMesh(scene->mMeshes[i], verts, bake_transform);
-		std::string tex_path;
-		if (verts.empty()) continue;
+		uint32_t skeleton = UINT32_MAX;
+		if (!caches[i].skeleton.empty())
+		{
+			skeleton = static_cast<uint32_t>(skeletons.size());
+			skeletons.push_back(caches[i].skeleton);
+		}
 
-		aiMaterial* material = scene->mMaterials[scene->mMeshes[i]->mMaterialIndex];
-		if (material->GetTextureCount(aiTextureType_DIFFUSE) == 1)
+		for (size_t m = 0; m < caches[i].meshes.size(); ++m)
 		{
-			aiString str;
-			material->GetTexture(aiTextureType_DIFFUSE, 0, &str);
-			tex_path = texture_directory + std::string(str.C_Str());
+			const auto& cached_mesh = caches[i].meshes[m];
+			auto& mesh = meshes.emplace_back();
+
+			mesh.texture = getTexture(mesh_texture_paths[i][m]);
+			mesh.skeleton = cached_mesh.influences ? skeleton : UINT32_MAX;
+
+			if (cached_mesh.index_size == sizeof(uint16_t))
+				mesh.geometry = geometry_pool.append(upload_batch, cached_mesh.vertices, cached_mesh.vertex_count, static_cast<const uint16_t*>(cached_mesh.indices), cached_mesh.index_count, cached_mesh.influences);
+			else
+				mesh.geometry = geometry_pool.append(upload_batch, cached_mesh.vertices, cached_mesh.vertex_count, static_cast<const uint32_t*>(cached_mesh.indices), cached_mesh.index_count, cached_mesh.influences);
+
+			mesh.transform = models[i].transform;
+			mesh.bounds_min = cached_mesh.bounds_min;
+			mesh.bounds_max = cached_mesh.bounds_max;
 		}
-		
-		auto& mesh = meshes.emplace_back();
-		mesh.texture.init(device_manager, tex_path);
-
-	    std::vector<uint32_t> indices{};
-	    indices.resize(verts.size());
-	    for (int i = 0; i < verts.size(); ++i)
-	    {
-	        indices[i] = i;
-	    }
-
-	    uploadBufferData(device_manager, mesh.vertex_buffer, verts, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
-	    uploadBufferData(device_manager, mesh.index_buffer, indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
 	}
 
+	// everything has been copied into staging memory, the mappings can go
+	for (auto& cache : caches)
+		cache.close();
+	for (auto& texture : textures)
+		texture.close(); // streamed ones have already been handed over
+
+	const UploadToken token = upload_batch.submit();
+	for (size_t i = first_mesh; i < meshes.size(); ++i)
+		meshes[i].upload = token;
+	for (Texture* texture : added_textures)
+		texture->upload = token;
+
+	return token;
 }
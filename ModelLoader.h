@@ -1,9 +1,13 @@
 #pragma once
 
 #include "Vertex.h"
-#include "VulkanWrapper/Buffer.h"
+#include "VulkanWrapper/GeometryPool.h"
 #include "VulkanWrapper/DeviceManager.h"
 #include "VulkanWrapper/Image.h"
+#include "VulkanWrapper/TextureCache.h"
+#include "VulkanWrapper/UploadQueue.h"
+#include "ThreadPool.h"
+#include "TextureStreamer.h"
 
 #include <string>
 #include <vector>
@@ -12,9 +16,26 @@ using namespace VulkanWrapper;
 
 struct Mesh
 {
-    VulkanWrapper::Buffer vertex_buffer;
-    VulkanWrapper::Buffer index_buffer;
-    Texture texture;
+    GeometryRange geometry;
+    Texture* texture; // shared through the TextureCache
+    uint32_t skeleton = UINT32_MAX; // index into loadModels' skeletons for skinned meshes
+
+    glm::mat4 transform;
+    glm::vec3 bounds_min; // model space, before transform
+    glm::vec3 bounds_max;
+
+    UploadToken upload; // only drawable once this has completed
+};
+
+struct ModelRequest
+{
+    std::string file_path; // a cooked .mesh, see asset_cooker
+    glm::mat4 transform = glm::mat4(1.0f); // becomes each mesh's model matrix
 };
 
-void loadModel(const std::string& file_path, const glm::mat4& bake_transform, std::vector<Mesh>& meshes, DeviceManager& device_manager);
\ No newline at end of file
+// Maps the cooked meshes and their textures on the thread pool, then copies everything into a single upload batch.
+// Textures already in texture_cache are shared rather than loaded again, each mesh holds a reference to its texture.
+// The new meshes are appended to meshes in request order. Every skinned model adds its skeleton to skeletons, one per
+// request, so each instance can be posed on its own. With a texture_streamer, large textures are uploaded with
+// only their mip tail and handed to the streamer, remove them from it before releasing them.
+UploadToken loadModels(const std::vector<ModelRequest>& models, std::vector<Mesh>& meshes, std::vector<Skeleton>& skeletons, GeometryPool& geometry_pool, TextureCache& texture_cache, DeviceManager& device_manager, ThreadPool& thread_pool, TextureStreamer* texture_streamer = nullptr);
\ No newline at end of file
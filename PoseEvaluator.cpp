@@ -0,0 +1,97 @@
+#include "PoseEvaluator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void PoseEvaluator::init(uint32_t thread_count)
+{
+    scratch.resize(thread_count);
+    for (auto& thread_scratch : scratch)
+    {
+        thread_scratch.pose.resize(Skeleton::max_joints);
+        thread_scratch.layer_pose.resize(Skeleton::max_joints);
+        thread_scratch.locals.resize(Skeleton::max_joints);
+        thread_scratch.models.resize(Skeleton::max_joints);
+    }
+}
+
+void PoseEvaluator::deinit()
+{
+    characters.clear();
+    changed.clear();
+    scratch.clear();
+}
+
+uint32_t PoseEvaluator::addCharacter(uint32_t skeleton, uint32_t palette_offset)
+{
+    Character& character = characters.emplace_back();
+    character.skeleton = skeleton;
+    character.palette_offset = palette_offset;
+    changed.push_back(0);
+    return static_cast<uint32_t>(characters.size() - 1);
+}
+
+void PoseEvaluator::evaluate(ThreadPool& thread_pool, const std::vector<Skeleton>& skeletons, glm::mat4* palettes)
+{
+    const size_t batch_count = std::min(characters.size(), thread_pool.threadCount() * jobs_per_thread);
+    if (batch_count == 0)
+        return;
+
+    const size_t batch_size = (characters.size() + batch_count - 1) / batch_count;
+    thread_pool.parallelFor(batch_count, [&](size_t batch, uint32_t thread_index)
+    {
+        const size_t end = std::min(characters.size(), (batch + 1) * batch_size);
+        for (size_t c = batch * batch_size; c < end; ++c)
+            evaluateCharacter(c, skeletons[characters[c].skeleton], scratch[thread_index], palettes);
+    });
+}
+
+void PoseEvaluator::evaluateCharacter(size_t index, const Skeleton& skeleton, Scratch& thread_scratch, glm::mat4* palettes)
+{
+    Character& character = characters[index];
+    const uint32_t joint_count = skeleton.jointCount();
+
+    if (character.layers.empty())
+    {
+        skeleton.localToModel(skeleton.bind_locals.data(), thread_scratch.models.data());
+        changed[index] = !character.evaluated;
+    }
+    else
+    {
+        // sample each layer and blend it over the ones before
+        for (size_t l = 0; l < character.layers.size(); ++l)
+        {
+            AnimationLayer& layer = character.layers[l];
+            if (l > 0 && layer.weight <= 0.0f)
+                continue;
+
+            const AnimationClip& clip = skeleton.clips[layer.clip];
+            float time = layer.time;
+            if (layer.loop && clip.duration > 0.0f)
+            {
+                time = std::fmod(time, clip.duration);
+                if (time < 0.0f)
+                    time += clip.duration;
+            }
+
+            JointPose* target = l == 0 ? thread_scratch.pose.data() : thread_scratch.layer_pose.data();
+            clip.sample(time, layer.cursor, target);
+            if (l > 0)
+                blendPoses(thread_scratch.pose.data(), target, joint_count, layer.weight, thread_scratch.pose.data());
+        }
+
+        const size_t pose_bytes = joint_count * sizeof(JointPose);
+        changed[index] = !character.evaluated || std::memcmp(character.pose.data(), thread_scratch.pose.data(), pose_bytes) != 0;
+        if (changed[index])
+            character.pose.assign(thread_scratch.pose.begin(), thread_scratch.pose.begin() + joint_count);
+
+        // propagate the hierarchy
+        poseToLocals(thread_scratch.pose.data(), joint_count, thread_scratch.locals.data());
+        skeleton.localToModel(thread_scratch.locals.data(), thread_scratch.models.data());
+    }
+    character.evaluated = true;
+
+    // palette, written every frame as each frame in flight has its own buffer
+    skeleton.buildPalette(thread_scratch.models.data(), palettes + character.palette_offset);
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "AnimationClip.h"
+#include "Skeleton.h"
+#include "ThreadPool.h"
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <vector>
+
+// One clip a character plays. Layers after the first blend over the pose of the ones before them by weight
+struct AnimationLayer
+{
+    uint32_t clip = 0; // into the skeleton's clips
+    float time = 0.0f; // seconds, wrapped into the clip when looping and clamped to it otherwise
+    float weight = 1.0f;
+    bool loop = true;
+    ClipCursor cursor;
+};
+
+// An animated instance of a skeleton and where its skinning matrices go in the palette buffer
+struct Character
+{
+    uint32_t skeleton;
+    uint32_t palette_offset;
+    std::vector<AnimationLayer> layers; // none holds the bind pose
+
+    std::vector<JointPose> pose; // the blended pose of the last evaluate, to tell whether it changed
+    bool evaluated = false;
+};
+
+// Evaluates every character's pose each frame as one job per batch of characters on the thread pool: sample each
+// layer, blend them, propagate the hierarchy and build the palette straight into the mapped palette buffer.
+// Characters don't share any writable state, so the jobs run without locks and scale with the worker count; the
+// scratch poses and matrices are per thread and reused across frames.
+struct PoseEvaluator
+{
+    static constexpr size_t jobs_per_thread = 4; // batches per thread, enough to even out characters of different cost
+
+    std::vector<Character> characters;
+    std::vector<uint8_t> changed; // per character, whether the last evaluate produced a different pose than before
+
+    void init(uint32_t thread_count);
+    void deinit();
+
+    uint32_t addCharacter(uint32_t skeleton, uint32_t palette_offset);
+
+    // palettes is the frame's palette buffer, only ever written to as it is usually uncached host memory
+    void evaluate(ThreadPool& thread_pool, const std::vector<Skeleton>& skeletons, glm::mat4* palettes);
+
+private:
+    struct Scratch
+    {
+        std::vector<JointPose> pose;
+        std::vector<JointPose> layer_pose;
+        std::vector<glm::mat4> locals;
+        std::vector<glm::mat4> models;
+    };
+
+    std::vector<Scratch> scratch; // per thread
+
+    void evaluateCharacter(size_t index, const Skeleton& skeleton, Scratch& thread_scratch, glm::mat4* palettes);
+};
@@ -1,3 +1,5 @@
 C:/VulkanSDK/1.2.135.0/Bin32/glslc.exe shader.vert -o vert.spv
+C:/VulkanSDK/1.2.135.0/Bin32/glslc.exe -DDRAW_DATA_BUFFER shader.vert -o vert_draw_buffer.spv
 C:/VulkanSDK/1.2.135.0/Bin32/glslc.exe shader.frag -o frag.spv
+C:/VulkanSDK/1.2.135.0/Bin32/glslc.exe skinning.comp -o skinning.spv
 pause
\ No newline at end of file
@@ -1,4 +1,6 @@
 #!/bin/sh
 
 /usr/bin/glslc shader.vert -o vert.spv
-/usr/bin/glslc shader.frag -o frag.spv
\ No newline at end of file
+/usr/bin/glslc -DDRAW_DATA_BUFFER shader.vert -o vert_draw_buffer.spv
+/usr/bin/glslc shader.frag -o frag.spv
+/usr/bin/glslc skinning.comp -o skinning.spv
\ No newline at end of file
@@ -1,14 +1,17 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragColour;
 layout(location = 1) in vec2 fragTexCoord;
+layout(location = 2) flat in uint fragTextureIndex;
 
 layout(location = 0) out vec4 outColour;
 
-layout(set = 1, binding = 0) uniform sampler2D texSampler;
+// bindless texture table, partially bound
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 
 void main() {
-    //outColour = vec4(fragColour * texture(texSampler, fragTexCoord).rgb, 1.0f);
-    outColour = vec4(texture(texSampler, fragTexCoord).rgb, 1.0f);
+    //outColour = vec4(fragColour * texture(textures[nonuniformEXT(fragTextureIndex)], fragTexCoord).rgb, 1.0f);
+    outColour = vec4(texture(textures[nonuniformEXT(fragTextureIndex)], fragTexCoord).rgb, 1.0f);
 }
\ No newline at end of file
@@ -5,19 +5,59 @@ layout(set = 0, binding = 0) uniform ViewInfo {
     mat4 view;
     mat4 proj;
 } view_info;
-layout(set = 1, binding = 1) uniform ModelInfo {
+
+struct DrawData {
     mat4 model;
-} model_info;
+    uint texture_index;
+    uint palette_offset; // 0xFFFFFFFF for static meshes
+};
+// the draw data is pushed when it fits, otherwise (compiled with DRAW_DATA_BUFFER, as vert_draw_buffer.spv) there
+// is one entry per mesh in the draw buffer, selected through the draw's first instance. The push constant block is
+// left out of that variant entirely, as its pipeline layout has no push constant range to cover it
+#ifndef DRAW_DATA_BUFFER
+layout(push_constant) uniform DrawConstants {
+    DrawData draw;
+} draw_constants;
+#endif
+
+layout(std430, set = 0, binding = 1) readonly buffer DrawBuffer {
+    DrawData draws[];
+} draw_buffer;
+
+// every skinned model's joint matrices, model space from the bind pose to the current pose
+layout(std430, set = 0, binding = 2) readonly buffer PaletteBuffer {
+    mat4 joints[];
+} palette_buffer;
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColour;
 layout(location = 2) in vec2 inTexCoord;
+layout(location = 3) in uvec4 inJoints;
+layout(location = 4) in vec4 inWeights; // unorm16, sum to 1
 
 layout(location = 0) out vec3 fragColor;
 layout(location = 1) out vec2 fragTexCoord;
+layout(location = 2) flat out uint fragTextureIndex;
 
 void main() {
-    gl_Position = view_info.proj * view_info.view * model_info.model * vec4(inPosition, 1.0);
+#ifdef DRAW_DATA_BUFFER
+    DrawData draw = draw_buffer.draws[gl_InstanceIndex];
+#else
+    DrawData draw = draw_constants.draw;
+#endif
+
+    vec4 position = vec4(inPosition, 1.0);
+    if (draw.palette_offset != 0xFFFFFFFFu)
+    {
+        mat4 skin = palette_buffer.joints[draw.palette_offset + inJoints.x] * inWeights.x
+            + palette_buffer.joints[draw.palette_offset + inJoints.y] * inWeights.y
+            + palette_buffer.joints[draw.palette_offset + inJoints.z] * inWeights.z
+            + palette_buffer.joints[draw.palette_offset + inJoints.w] * inWeights.w;
+        position = skin * position;
+    }
+
+    gl_Position = view_info.proj * view_info.view * draw.model * position;
     fragColor = inColour;
     fragTexCoord = inTexCoord;
+    fragTextureIndex = draw.texture_index;
 }
\ No newline at end of file
@@ -0,0 +1,63 @@
+#include "Skeleton.h"
+
+#include <algorithm>
+#include <cmath>
+
+SkinInfluence packSkinInfluence(const uint32_t* joints, const float* weights, uint32_t count)
+{
+    uint32_t order[4];
+    uint32_t kept = 0;
+
+    // insertion into the 4 largest so far, ties keep the earlier joint
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        if (!(weights[i] > 0.0f))
+            continue;
+
+        uint32_t slot = std::min(kept, 3u);
+        if (kept == 4 && weights[i] <= weights[order[3]])
+            continue;
+        while (slot > 0 && weights[i] > weights[order[slot - 1]])
+        {
+            order[slot] = order[slot - 1];
+            --slot;
+        }
+        order[slot] = i;
+        kept = std::min(kept + 1, 4u);
+    }
+
+    SkinInfluence influence{};
+    if (kept == 0)
+    {
+        influence.weights[0] = 65535;
+        return influence;
+    }
+
+    float total = 0.0f;
+    for (uint32_t i = 0; i < kept; ++i)
+        total += weights[order[i]];
+
+    // rounding error goes to the largest weight so the sum stays exact
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < kept; ++i)
+    {
+        influence.joints[i] = static_cast<uint8_t>(joints[order[i]]);
+        influence.weights[i] = static_cast<uint16_t>(std::lround(weights[order[i]] / total * 65535.0f));
+        sum += influence.weights[i];
+    }
+    influence.weights[0] = static_cast<uint16_t>(influence.weights[0] + 65535 - static_cast<int32_t>(sum));
+
+    return influence;
+}
+
+void Skeleton::localToModel(const glm::mat4* locals, glm::mat4* models) const
+{
+    for (size_t i = 0; i < parents.size(); ++i)
+        models[i] = parents[i] < 0 ? locals[i] : models[parents[i]] * locals[i];
+}
+
+void Skeleton::buildPalette(const glm::mat4* models, glm::mat4* palette) const
+{
+    for (size_t i = 0; i < inverse_binds.size(); ++i)
+        palette[i] = models[i] * inverse_binds[i];
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "AnimationClip.h"
+
+#include "glm/glm.hpp"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Per vertex skinning influences: the four joints with the largest weights, as indices into the model's Skeleton,
+// and their weights in unorm16. Weights sum to exactly 65535, unused slots have weight 0
+struct SkinInfluence
+{
+    uint8_t joints[4];
+    uint16_t weights[4];
+};
+
+// keeps the largest 4 of count (joint, weight) pairs and normalises them, vertices without any weight are bound
+// fully to joint 0
+SkinInfluence packSkinInfluence(const uint32_t* joints, const float* weights, uint32_t count);
+
+// Joint hierarchy of a skinned model, imported from the bones of its meshes and every node above them. Joints are
+// ordered so parents come before their children, so poses can be propagated in a single pass
+struct Skeleton
+{
+    static constexpr uint32_t max_joints = 256; // influences store joints as uint8
+
+    std::vector<std::string> names; // the source nodes' names, which animation channels refer to
+    std::vector<int32_t> parents; // -1 for roots
+    std::vector<glm::mat4> bind_locals; // bind pose, relative to the parent
+    std::vector<glm::mat4> inverse_binds; // model space to joint space in the bind pose
+    std::vector<AnimationClip> clips; // the model's animations, with a track for every joint
+
+    uint32_t jointCount() const { return static_cast<uint32_t>(parents.size()); }
+    bool empty() const { return parents.empty(); }
+
+    // joint transforms relative to their parents to model space, locals and models hold jointCount() matrices
+    void localToModel(const glm::mat4* locals, glm::mat4* models) const;
+
+    // model space joint transforms to the skinning matrices the vertex shader blends
+    void buildPalette(const glm::mat4* models, glm::mat4* palette) const;
+};
@@ -0,0 +1,313 @@
+#include "CpuSkinning.h"
+#include "MeshCache.h"
+#include "PoseEvaluator.h"
+#include "Skeleton.h"
+#include "ThreadPool.h"
+#include "Vertex.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Measures CPU skinning throughput at every instruction set level this machine supports, single threaded and
+// across the thread pool, and checks each level against the reference.
+//
+// usage: skinning_benchmark [cooked .mesh]
+// Without a mesh a synthetic one is skinned: random positions and influences over a 128 joint palette
+//
+// usage: skinning_benchmark poses [character count] [cooked .mesh]
+// Measures PoseEvaluator instead: milliseconds per frame to sample, blend, propagate and build the palettes of
+// every character, on one thread and on growing numbers of threads up to the whole pool. Characters share the
+// mesh's skeleton and play its first two clips, or a synthetic 64 joint skeleton with two 2 second clips without one
+
+static constexpr uint32_t synthetic_vertex_count = 1u << 20;
+static constexpr uint32_t synthetic_joint_count = 128;
+static constexpr uint32_t repetitions = 20;
+static constexpr uint32_t default_character_count = 500;
+static constexpr uint32_t synthetic_skeleton_joints = 64;
+static constexpr uint32_t synthetic_clip_keys = 61; // 2 seconds at 30 keys per second
+
+// every skinned mesh of the cache back to back, palettes in its bind pose
+static bool loadMesh(const char* path, std::vector<Vertex>& vertices, std::vector<SkinInfluence>& influences, std::vector<glm::mat4>& palette)
+{
+    MeshCache cache;
+    if (!cache.open(path, sizeof(Vertex)))
+    {
+        printf("failed to open %s\n", path);
+        return false;
+    }
+
+    for (const auto& mesh : cache.meshes)
+    {
+        if (!mesh.influences)
+            continue;
+
+        const Vertex* mesh_vertices = static_cast<const Vertex*>(mesh.vertices);
+        vertices.insert(vertices.end(), mesh_vertices, mesh_vertices + mesh.vertex_count);
+        influences.insert(influences.end(), mesh.influences, mesh.influences + mesh.vertex_count);
+    }
+
+    std::vector<glm::mat4> models(cache.skeleton.jointCount());
+    palette.resize(cache.skeleton.jointCount());
+    cache.skeleton.localToModel(cache.skeleton.bind_locals.data(), models.data());
+    cache.skeleton.buildPalette(models.data(), palette.data());
+
+    cache.close();
+
+    if (vertices.empty())
+    {
+        printf("%s has no skinned meshes\n", path);
+        return false;
+    }
+    return true;
+}
+
+static void makeSynthetic(std::vector<Vertex>& vertices, std::vector<SkinInfluence>& influences, std::vector<glm::mat4>& palette)
+{
+    std::mt19937 random(1);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_int_distribution<uint32_t> joint(0, synthetic_joint_count - 1);
+
+    palette.resize(synthetic_joint_count);
+    for (auto& matrix : palette)
+    {
+        for (int column = 0; column < 4; ++column)
+        {
+            for (int row = 0; row < 3; ++row)
+                matrix[column][row] = unit(random);
+        }
+        matrix[3][3] = 1.0f;
+    }
+
+    vertices.resize(synthetic_vertex_count);
+    influences.resize(synthetic_vertex_count);
+    for (uint32_t i = 0; i < synthetic_vertex_count; ++i)
+    {
+        vertices[i] = {};
+        vertices[i].pos = glm::vec3(unit(random), unit(random), unit(random)) * 10.0f;
+
+        const uint32_t joints[4] = { joint(random), joint(random), joint(random), joint(random) };
+        const float weights[4] = { std::abs(unit(random)), std::abs(unit(random)), std::abs(unit(random)), std::abs(unit(random)) };
+        influences[i] = packSkinInfluence(joints, weights, 4);
+    }
+}
+
+// best of repetitions, in vertices per second
+template<typename Skin>
+static double measure(size_t vertex_count, const Skin& skin)
+{
+    double best = 0.0;
+    for (uint32_t r = 0; r < repetitions; ++r)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        skin();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::max(best, vertex_count / elapsed.count());
+    }
+    return best;
+}
+
+// a balanced joint tree whose clips swing every joint about its own axis, with constant translations and scales
+static void makeSyntheticSkeleton(Skeleton& skeleton)
+{
+    for (uint32_t j = 0; j < synthetic_skeleton_joints; ++j)
+    {
+        skeleton.names.push_back("joint" + std::to_string(j));
+        skeleton.parents.push_back(j == 0 ? -1 : static_cast<int32_t>((j - 1) / 2));
+        skeleton.bind_locals.push_back(glm::mat4(1.0f));
+        skeleton.inverse_binds.push_back(glm::mat4(1.0f));
+    }
+
+    for (uint32_t c = 0; c < 2; ++c)
+    {
+        AnimationClip& clip = skeleton.clips.emplace_back();
+        clip.name = c == 0 ? "swing" : "sway";
+        clip.duration = (synthetic_clip_keys - 1) / 30.0f;
+        clip.joint_count = synthetic_skeleton_joints;
+
+        for (uint32_t j = 0; j < synthetic_skeleton_joints; ++j)
+        {
+            AnimationTrack rotation_track{};
+            rotation_track.first_key = static_cast<uint32_t>(clip.rotations.size());
+            rotation_track.key_count = synthetic_clip_keys;
+            clip.tracks[AnimationClip::Rotation].push_back(rotation_track);
+
+            const glm::vec3 axis = glm::normalize(glm::vec3(1.0f + j % 3, 1.0f + j % 5, 1.0f + c));
+            for (uint32_t k = 0; k < synthetic_clip_keys; ++k)
+            {
+                const float half_angle = std::sin(k * 0.2f + j + c) * 0.5f;
+                const glm::vec3 v = axis * std::sin(half_angle);
+                clip.times[AnimationClip::Rotation].push_back(static_cast<uint16_t>(k * 65535u / (synthetic_clip_keys - 1)));
+                clip.rotations.push_back(packRotation(glm::quat(std::cos(half_angle), v.x, v.y, v.z)));
+            }
+
+            AnimationTrack translation_track{};
+            translation_track.first_key = static_cast<uint32_t>(clip.translations.size());
+            translation_track.key_count = 1;
+            translation_track.range_min = glm::vec3(0.0f, 1.0f, 0.0f);
+            clip.tracks[AnimationClip::Translation].push_back(translation_track);
+            clip.times[AnimationClip::Translation].push_back(0);
+            clip.translations.push_back({});
+
+            AnimationTrack scale_track{};
+            scale_track.first_key = static_cast<uint32_t>(clip.scales.size());
+            scale_track.key_count = 1;
+            scale_track.range_min = glm::vec3(1.0f);
+            clip.tracks[AnimationClip::Scale].push_back(scale_track);
+            clip.times[AnimationClip::Scale].push_back(0);
+            clip.scales.push_back({});
+        }
+    }
+}
+
+// best milliseconds per frame of evaluating every character, frames 1/60 s apart
+static double measurePoses(ThreadPool& thread_pool, PoseEvaluator& pose_evaluator, const std::vector<Skeleton>& skeletons, glm::mat4* palettes, float& time)
+{
+    double best = 0.0;
+    for (uint32_t r = 0; r < repetitions; ++r)
+    {
+        time += 1.0f / 60.0f;
+        for (size_t c = 0; c < pose_evaluator.characters.size(); ++c)
+        {
+            for (auto& layer : pose_evaluator.characters[c].layers)
+                layer.time = time + c * 0.013f;
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        pose_evaluator.evaluate(thread_pool, skeletons, palettes);
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        best = r == 0 ? elapsed.count() : std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+static int benchmarkPoses(uint32_t character_count, const char* mesh_path)
+{
+    std::vector<Skeleton> skeletons(1);
+    if (mesh_path)
+    {
+        MeshCache cache;
+        if (!cache.open(mesh_path, sizeof(Vertex)))
+        {
+            printf("failed to open %s\n", mesh_path);
+            return 1;
+        }
+        skeletons[0] = cache.skeleton;
+        cache.close();
+
+        if (skeletons[0].clips.empty())
+        {
+            printf("%s has no animations\n", mesh_path);
+            return 1;
+        }
+    }
+    else
+        makeSyntheticSkeleton(skeletons[0]);
+
+    const Skeleton& skeleton = skeletons[0];
+    std::vector<glm::mat4> palettes(size_t(character_count) * skeleton.jointCount());
+
+    ThreadPool full_pool;
+    full_pool.init();
+    const uint32_t max_threads = full_pool.threadCount();
+    full_pool.deinit();
+
+    printf("%u characters, %u joints, %zu layers each, up to %u threads\n", character_count, skeleton.jointCount(), std::min<size_t>(2, skeleton.clips.size()), max_threads);
+    printf("%-8s %12s %12s %12s\n", "threads", "ms/frame", "speedup", "efficiency");
+
+    float time = 0.0f;
+    double single = 0.0;
+    for (uint32_t thread_count = 1; ; thread_count = std::min(thread_count * 2, max_threads))
+    {
+        // a pool that was never started has no workers, its parallelFor runs everything on the calling thread
+        ThreadPool thread_pool;
+        if (thread_count > 1)
+            thread_pool.init(thread_count - 1);
+
+        PoseEvaluator pose_evaluator;
+        pose_evaluator.init(thread_pool.threadCount());
+        for (uint32_t c = 0; c < character_count; ++c)
+        {
+            Character& character = pose_evaluator.characters[pose_evaluator.addCharacter(0, c * skeleton.jointCount())];
+            for (uint32_t clip = 0; clip < std::min<size_t>(2, skeleton.clips.size()); ++clip)
+                character.layers.push_back({ clip, 0.0f, 0.5f });
+        }
+
+        const double ms = measurePoses(thread_pool, pose_evaluator, skeletons, palettes.data(), time);
+        if (thread_count == 1)
+            single = ms;
+        printf("%-8u %12.3f %12.2f %11.0f%%\n", thread_count, ms, single / ms, single / ms / thread_count * 100.0);
+
+        pose_evaluator.deinit();
+        if (thread_count > 1)
+            thread_pool.deinit();
+        if (thread_count == max_threads)
+            break;
+    }
+
+    return 0;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "poses") == 0)
+    {
+        const uint32_t character_count = argc > 2 ? static_cast<uint32_t>(std::max(1, std::atoi(argv[2]))) : default_character_count;
+        return benchmarkPoses(character_count, argc > 3 ? argv[3] : nullptr);
+    }
+
+    std::vector<Vertex> vertices;
+    std::vector<SkinInfluence> influences;
+    std::vector<glm::mat4> palette;
+
+    if (argc > 1)
+    {
+        if (!loadMesh(argv[1], vertices, influences, palette))
+            return 1;
+    }
+    else
+        makeSynthetic(vertices, influences, palette);
+
+    const size_t vertex_count = vertices.size();
+
+    std::vector<glm::vec3> reference(vertex_count);
+    skinVerticesReference(vertices.data(), influences.data(), vertex_count, palette.data(), reference.data());
+
+    SkinningStreams streams;
+    streams.assign(vertices.data(), influences.data(), vertex_count);
+
+    SkinnedPositions skinned;
+    skinned.resize(vertex_count);
+
+    ThreadPool thread_pool;
+    thread_pool.init();
+
+    const SimdLevel best_level = detectSimdLevel();
+    printf("%zu vertices, %zu joints, %u threads, best level %s\n", vertex_count, palette.size(), thread_pool.threadCount(), simdLevelName(best_level));
+    printf("%-8s %16s %16s %12s\n", "level", "Mvertices/s", "threaded", "max error");
+
+    for (int level_index = 0; level_index <= static_cast<int>(best_level); ++level_index)
+    {
+        const SimdLevel level = static_cast<SimdLevel>(level_index);
+
+        const double single = measure(vertex_count, [&]() { skinVertices(level, streams, palette.data(), 0, vertex_count, skinned); });
+        const double threaded = measure(vertex_count, [&]() { skinVerticesParallel(thread_pool, level, streams, palette.data(), skinned); });
+
+        float max_error = 0.0f;
+        for (size_t i = 0; i < vertex_count; ++i)
+        {
+            for (int axis = 0; axis < 3; ++axis)
+                max_error = std::max(max_error, std::abs(skinned.position[axis][i] - reference[i][axis]));
+        }
+
+        printf("%-8s %16.1f %16.1f %12g\n", simdLevelName(level), single * 1e-6, threaded * 1e-6, max_error);
+    }
+
+    thread_pool.deinit();
+    return 0;
+}
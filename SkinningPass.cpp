@@ -0,0 +1,146 @@
+#include "SkinningPass.h"
+
+#include <algorithm>
+
+// matches SkinningConstants in skinning.comp
+struct SkinningConstants
+{
+    uint32_t source_first_vertex;
+    uint32_t output_first_vertex;
+    uint32_t vertex_count;
+    uint32_t palette_offset;
+};
+
+void SkinningPass::init(DeviceManager& device_manager, const std::vector<Mesh>& meshes)
+{
+    uint32_t output_vertex_count = 0;
+    mesh_jobs.assign(meshes.size(), UINT32_MAX);
+    for (uint32_t m = 0; m < meshes.size(); ++m)
+    {
+        if (meshes[m].skeleton == UINT32_MAX)
+            continue;
+
+        mesh_jobs[m] = static_cast<uint32_t>(jobs.size());
+
+        Job job{};
+        job.mesh = m;
+        job.skeleton = meshes[m].skeleton;
+        job.output_first_vertex = output_vertex_count;
+        jobs.push_back(job);
+
+        output_vertex_count += meshes[m].geometry.vertex_count;
+    }
+
+    output_buffer.init(device_manager, std::max<uint32_t>(1, output_vertex_count) * sizeof(Vertex), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    output_buffer.count = output_vertex_count;
+
+    // source vertices, source influences, palettes and the output
+    descriptor_set_layout.update_per_frame = false;
+    descriptor_set_layout.count = 1;
+    descriptor_set_layout.bindings.resize(4);
+    for (auto& binding : descriptor_set_layout.bindings)
+    {
+        binding.stage_flags = VK_SHADER_STAGE_COMPUTE_BIT;
+        binding.descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+    descriptor_set_layout.upload(device_manager);
+
+    ComputeShaderSettings shader_settings{};
+    shader_settings.comp_addr = "../Shaders/skinning.spv";
+    shader_settings.descriptor_set_layouts = { descriptor_set_layout };
+    shader_settings.push_constant_ranges.push_back({ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SkinningConstants) });
+    shader_settings.specialization_constants = { workgroup_size };
+    pipeline.init(device_manager, shader_settings);
+}
+
+void SkinningPass::deinit(DeviceManager& device_manager)
+{
+    pipeline.deinit(device_manager);
+    descriptor_set_layout.deinit(device_manager);
+    output_buffer.deinit(device_manager);
+
+    jobs.clear();
+    mesh_jobs.clear();
+}
+
+void SkinningPass::markDirty(const uint32_t skeleton)
+{
+    for (auto& job : jobs)
+    {
+        if (job.skeleton == skeleton)
+            job.dirty = true;
+    }
+}
+
+void SkinningPass::record(DeviceManager& device_manager, DescriptorPool& descriptor_pool, GeometryPool& geometry_pool, const std::vector<Mesh>& meshes, VkCommandBuffer command_buffer, Buffer& palette_buffer, const std::vector<uint32_t>& palette_offsets)
+{
+    bool recording = false;
+
+    for (auto& job : jobs)
+    {
+        const Mesh& mesh = meshes[job.mesh];
+
+        // meshes still uploading stay dirty and are skinned once their vertices are there
+        if (!job.dirty || !device_manager.upload_queue.isComplete(mesh.upload))
+            continue;
+
+        if (!recording)
+        {
+            // earlier frames may still fetch the previous pose, only an execution dependency is needed for that
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.buffer = output_buffer.handle;
+            barrier.offset = 0;
+            barrier.size = VK_WHOLE_SIZE;
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline);
+            recording = true;
+        }
+
+        // one set per page and palette buffer, cached by the pool after the first frame
+        GeometryPage& page = geometry_pool.pages[mesh.geometry.page];
+        const VkDescriptorSet descriptor_set = descriptor_pool.getCachedDescriptorSet(descriptor_set_layout, { &page.vertex_buffer, &page.skin_buffer, &palette_buffer, &output_buffer }, {});
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.pipeline_layout, 0, 1, &descriptor_set, 0, nullptr);
+
+        SkinningConstants constants{};
+        constants.source_first_vertex = static_cast<uint32_t>(mesh.geometry.vertex_offset);
+        constants.output_first_vertex = job.output_first_vertex;
+        constants.vertex_count = mesh.geometry.vertex_count;
+        constants.palette_offset = palette_offsets[job.skeleton];
+        vkCmdPushConstants(command_buffer, pipeline.pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(SkinningConstants), &constants);
+
+        pipeline.dispatch(command_buffer, mesh.geometry.vertex_count, workgroup_size);
+
+        job.dirty = false;
+        job.skinned = true;
+    }
+
+    if (recording)
+    {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = output_buffer.handle;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+    }
+}
+
+void SkinningPass::bind(VkCommandBuffer command_buffer, const GeometryPool& geometry_pool, const uint32_t page, const VkIndexType index_type) const
+{
+    // binding 1 is never read by static draws, see GeometryPool::bind
+    const VkBuffer buffers[2] = { output_buffer.handle, output_buffer.handle };
+    const VkDeviceSize offsets[2] = { 0, 0 };
+    vkCmdBindVertexBuffers(command_buffer, 0, 2, buffers, offsets);
+
+    geometry_pool.bindIndices(command_buffer, page, index_type);
+}
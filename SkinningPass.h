@@ -0,0 +1,57 @@
+#pragma once
+
+#include "ModelLoader.h"
+#include "VulkanWrapper/Buffer.h"
+#include "VulkanWrapper/ComputePipeline.h"
+#include "VulkanWrapper/DescriptorPool.h"
+#include "VulkanWrapper/DeviceManager.h"
+#include "VulkanWrapper/GeometryPool.h"
+
+#include <vector>
+
+using namespace VulkanWrapper;
+
+// Optional compute pre-pass that skins every animated mesh once per frame into a single output vertex buffer, laid
+// out like Vertex. Skinned meshes are then drawn from that buffer as if they were static, so the vertex shader (and
+// every pass after the first) no longer blends joints per draw.
+//
+// Output is kept between frames: a mesh is only skinned again after markDirty() was called for its skeleton. The
+// buffer is shared by all frames in flight, which is safe as every frame is submitted to the same queue and the
+// pass waits for earlier vertex fetches before overwriting it.
+struct SkinningPass
+{
+    static constexpr uint32_t workgroup_size = 64;
+
+    struct Job
+    {
+        uint32_t mesh;
+        uint32_t skeleton;
+        uint32_t output_first_vertex;
+        bool dirty = true;
+        bool skinned = false; // output holds a pose, the mesh can be drawn from it
+    };
+
+    ComputePipeline pipeline;
+    DescriptorSetLayout descriptor_set_layout;
+    Buffer output_buffer;
+
+    std::vector<Job> jobs;
+    std::vector<uint32_t> mesh_jobs; // per mesh, UINT32_MAX for static meshes
+
+    // meshes are the whole scene, the ones with a skeleton get an output range
+    void init(DeviceManager& device_manager, const std::vector<Mesh>& meshes);
+    void deinit(DeviceManager& device_manager);
+
+    void markDirty(const uint32_t skeleton);
+
+    // records the dispatches of every dirty job whose mesh has finished uploading, outside of any render pass
+    void record(DeviceManager& device_manager, DescriptorPool& descriptor_pool, GeometryPool& geometry_pool, const std::vector<Mesh>& meshes, VkCommandBuffer command_buffer, Buffer& palette_buffer, const std::vector<uint32_t>& palette_offsets);
+
+    // whether mesh is drawn from the output buffer, at outputVertexOffset(mesh) instead of its geometry's offset
+    bool drawsSkinned(const size_t mesh) const { return mesh_jobs[mesh] != UINT32_MAX; }
+    bool ready(const size_t mesh) const { return jobs[mesh_jobs[mesh]].skinned; }
+    int32_t outputVertexOffset(const size_t mesh) const { return static_cast<int32_t>(jobs[mesh_jobs[mesh]].output_first_vertex); }
+
+    // the output buffer at both vertex bindings, so it reads as static geometry, and the page's indices
+    void bind(VkCommandBuffer command_buffer, const GeometryPool& geometry_pool, const uint32_t page, const VkIndexType index_type) const;
+};
@@ -2,10 +2,18 @@
 #include "Vertex.h"
 #include "ModelLoader.h"
 #include "ImguiImpl.h"
+#include "PoseEvaluator.h"
+#include "SkinningPass.h"
+#include "VulkanWrapper/TextureTable.h"
+#include "VulkanWrapper/UniformRing.h"
 
 #include <glm/glm.hpp>
 #include "glm/gtc/matrix_transform.hpp"
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
 
 struct ViewInfo
 {
@@ -13,40 +21,99 @@ struct ViewInfo
     alignas(16) glm::mat4 proj;
 };
 
-struct ModelInfo
+// per draw, pushed as constants when the device has room for them, otherwise read by the vertex shader from the
+// frame's draw buffer at gl_InstanceIndex (std430)
+struct DrawData
 {
     alignas(16) glm::mat4 model;
+    uint32_t texture_index; // into the bindless texture table
+    uint32_t palette_offset; // first of the mesh's skinning matrices in the palette buffer, UINT32_MAX if static
+    uint32_t padding[2];
 };
 
 int main()
 {
     std::vector<Mesh> meshes;
-    std::vector<Buffer> uniform_buffers;
-    std::vector<VkDescriptorSet> descriptor_sets;
+    GeometryPool geometry_pool;
+    TextureCache texture_cache;
+    std::vector<uint32_t> draw_texture_indices; // per mesh, resolved on the main thread before the draws are recorded
+    bool push_draw_data = true;
+    const bool force_draw_buffer = false; // debug: read per draw data from the draw buffer even where it fits in push constants
+    std::vector<Buffer> draw_buffers; // per frame in flight, a DrawData per mesh when it isn't pushed
+    std::vector<Skeleton> skeletons; // one per skinned model instance
+    std::vector<uint32_t> palette_offsets; // per skeleton
+    PoseEvaluator pose_evaluator; // a character per skeleton
+    std::vector<Buffer> palette_buffers; // per frame in flight, every skeleton's skinning matrices back to back
+    // skinned meshes are skinned by a compute pre-pass and drawn as static geometry, otherwise the vertex shader
+    // blends the palette on every draw
+    const bool compute_skinning = true;
+    SkinningPass skinning_pass;
+    std::vector<VkDescriptorSet> frame_descriptor_sets; // per frame in flight
+    TextureTable texture_table;
+    TextureStreamer texture_streamer;
+    UniformRing uniform_ring;
+    uint32_t view_info_offset = 0;
 
     VulkanInstance instance{};
 
-    instance.command_buffer_callback = [&meshes, &descriptor_sets](const VulkanWrapper::Pipeline& pipeline, const size_t i, const VkCommandBuffer command_buffer)
+    // draws are recorded every frame on the instance's worker threads, a range of meshes per secondary command buffer
+    instance.draw_count_callback = [&meshes](const size_t frame_index)
     {
-        for (size_t m = 0; m < meshes.size(); m++)
-        {
-            auto& mesh = meshes[m];
-            VkBuffer vertexBuffers[] = { mesh.vertex_buffer.handle };
-            VkDeviceSize offsets[] = { 0 };
-            vkCmdBindVertexBuffers(command_buffer, 0, 1, vertexBuffers, offsets);
+        return meshes.size();
+    };
 
-            vkCmdBindIndexBuffer(command_buffer, mesh.index_buffer.handle, 0, VK_INDEX_TYPE_UINT32);
+    instance.draw_range_callback = [&meshes, &geometry_pool, &frame_descriptor_sets, &texture_table, &draw_texture_indices, &push_draw_data, &palette_offsets, &compute_skinning, &skinning_pass, &view_info_offset, &device_manager = instance.device_manager](const VulkanWrapper::Pipeline& pipeline, const size_t frame_index, size_t first_draw, size_t draw_count, const VkCommandBuffer command_buffer)
+    {
+        // per draw data is pushed or indexed by instance, so the descriptor sets are bound once per command buffer
+        VkDescriptorSet descriptor_set_ptrs[2] = { frame_descriptor_sets[frame_index], texture_table.descriptor_set };
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline_layout, 0, 2, &descriptor_set_ptrs[0], 1, &view_info_offset);
 
-            VkDescriptorSet descriptor_set_ptrs[2] = { descriptor_sets[i], descriptor_sets[pipeline.swapchain_image_size + m] };
+        // geometry is only rebound when the page, index width or vertex source changes
+        uint32_t bound_page = UINT32_MAX;
+        VkIndexType bound_index_type = VK_INDEX_TYPE_MAX_ENUM;
+        bool bound_skinned = false;
 
-            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.pipeline_layout, 0, 2, &descriptor_set_ptrs[0], 0, nullptr);
+        for (size_t m = first_draw; m < first_draw + draw_count; m++)
+        {
+            auto& mesh = meshes[m];
 
-            vkCmdDrawIndexed(command_buffer, static_cast<uint32_t>(mesh.index_buffer.count), 1, 0, 0, 0);
+            // meshes still streaming in are skipped rather than stalling the frame
+            if (!device_manager.upload_queue.isComplete(mesh.upload) || !device_manager.upload_queue.isComplete(mesh.texture->upload))
+                continue;
+
+            // pre-skinned meshes read the skinning pass's output, which only exists once it has run for them
+            const bool skinned = compute_skinning && skinning_pass.drawsSkinned(m);
+            if (skinned && !skinning_pass.ready(m))
+                continue;
+
+            if (mesh.geometry.page != bound_page || mesh.geometry.index_type != bound_index_type || skinned != bound_skinned)
+            {
+                if (skinned)
+                    skinning_pass.bind(command_buffer, geometry_pool, mesh.geometry.page, mesh.geometry.index_type);
+                else
+                    geometry_pool.bind(command_buffer, mesh.geometry.page, mesh.geometry.index_type);
+                bound_page = mesh.geometry.page;
+                bound_index_type = mesh.geometry.index_type;
+                bound_skinned = skinned;
+            }
+
+            if (push_draw_data)
+            {
+                DrawData draw{};
+                draw.model = mesh.transform;
+                draw.texture_index = draw_texture_indices[m];
+                draw.palette_offset = mesh.skeleton != UINT32_MAX && !skinned ? palette_offsets[mesh.skeleton] : UINT32_MAX;
+                vkCmdPushConstants(command_buffer, pipeline.pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawData), &draw);
+            }
+
+            // otherwise the first instance selects the mesh's DrawData
+            const int32_t vertex_offset = skinned ? skinning_pass.outputVertexOffset(m) : mesh.geometry.vertex_offset;
+            vkCmdDrawIndexed(command_buffer, mesh.geometry.index_count, 1, mesh.geometry.first_index, vertex_offset, static_cast<uint32_t>(m));
         }
     };
 
     auto last_time = glfwGetTime();
-    instance.update_uniforms_callback = [&swapchain = instance.swapchain, &last_time, &uniform_buffers](size_t image_index, VkDevice logical_device)
+    instance.update_uniforms_callback = [&swapchain = instance.swapchain, &last_time, &uniform_ring, &view_info_offset, &meshes, &texture_streamer, &texture_table, &draw_texture_indices, &push_draw_data, &draw_buffers, &skeletons, &palette_offsets, &pose_evaluator, &palette_buffers, &compute_skinning, &skinning_pass, &thread_pool = instance.thread_pool, &device_manager = instance.device_manager](size_t frame_index, VkDevice logical_device)
     {
         auto new_time = glfwGetTime();
         auto delta_time = new_time - last_time;
@@ -60,7 +127,64 @@ int main()
         view_info.proj = glm::perspective(glm::radians(45.0f), swapchain.extent.width / (float)swapchain.extent.height, 0.1f, 100.0f);
         view_info.proj[1][1] *= -1; // correction of inverted Y in OpenGL
 
-        uploadData(uniform_buffers[image_index], logical_device, &view_info);
+        uniform_ring.beginFrame(static_cast<uint32_t>(frame_index));
+        view_info_offset = uniform_ring.push(view_info);
+
+        // texture mips stream in and out by how large each mesh appears on screen
+        for (const auto& mesh : meshes)
+        {
+            const glm::vec3 center = glm::vec3(mesh.transform * glm::vec4((mesh.bounds_min + mesh.bounds_max) * 0.5f, 1.0f));
+            const float scale = std::max({ glm::length(glm::vec3(mesh.transform[0])), glm::length(glm::vec3(mesh.transform[1])), glm::length(glm::vec3(mesh.transform[2])) });
+            const float radius = glm::length(mesh.bounds_max - mesh.bounds_min) * 0.5f * scale;
+
+            const glm::vec3 view_center = glm::vec3(view_info.view * glm::vec4(center, 1.0f));
+            texture_streamer.request(mesh.texture, projectedSize(view_center, radius, std::abs(view_info.proj[1][1]), static_cast<float>(swapchain.extent.height)));
+        }
+        texture_streamer.update(device_manager);
+
+        // texture indices change when the streamer swaps an image, so they are looked up every frame
+        texture_table.beginFrame();
+        draw_texture_indices.resize(meshes.size());
+        for (size_t m = 0; m < meshes.size(); ++m)
+            draw_texture_indices[m] = texture_table.index(logical_device, *meshes[m].texture);
+
+        if (!push_draw_data)
+        {
+            DrawData* draws = static_cast<DrawData*>(draw_buffers[frame_index].allocation.mapped);
+            for (size_t m = 0; m < meshes.size(); ++m)
+            {
+                draws[m].model = meshes[m].transform;
+                draws[m].texture_index = draw_texture_indices[m];
+                draws[m].palette_offset = meshes[m].skeleton != UINT32_MAX && !(compute_skinning && skinning_pass.drawsSkinned(m)) ? palette_offsets[meshes[m].skeleton] : UINT32_MAX;
+            }
+        }
+
+        // skinned models loop their first clip and fade their second in and out over it, models without any stay in
+        // their bind pose
+        for (auto& character : pose_evaluator.characters)
+        {
+            for (auto& layer : character.layers)
+                layer.time = static_cast<float>(new_time);
+            if (character.layers.size() > 1)
+                character.layers[1].weight = 0.5f + 0.5f * std::sin(static_cast<float>(new_time) * 0.5f);
+        }
+        pose_evaluator.evaluate(thread_pool, skeletons, static_cast<glm::mat4*>(palette_buffers[frame_index].allocation.mapped));
+
+        // the pre-pass only reskins meshes whose pose differs from the one their output was skinned with
+        if (compute_skinning)
+        {
+            for (size_t c = 0; c < pose_evaluator.characters.size(); ++c)
+            {
+                if (pose_evaluator.changed[c])
+                    skinning_pass.markDirty(pose_evaluator.characters[c].skeleton);
+            }
+        }
+    };
+
+    instance.pre_pass_callback = [&meshes, &geometry_pool, &palette_buffers, &palette_offsets, &compute_skinning, &skinning_pass, &descriptor_pool = instance.descriptor_pool, &device_manager = instance.device_manager](size_t frame_index, VkCommandBuffer command_buffer)
+    {
+        if (compute_skinning)
+            skinning_pass.record(device_manager, descriptor_pool, geometry_pool, meshes, command_buffer, palette_buffers[frame_index], palette_offsets);
     };
 
     ImguiImpl imgui{};
@@ -69,63 +193,90 @@ int main()
         imgui.swapchainRecreate(instance);
     };
 
-    instance.render_frame_callback = [&](size_t frame_index)
+    instance.render_frame_callback = [&](size_t frame_index, uint32_t image_index)
     {
-        imgui.renderFrame(instance, frame_index);
+        imgui.renderFrame(instance, frame_index, image_index);
         return imgui.command_buffer_set[frame_index];
     };
 
     instance.init();
 
     imgui.init(instance);
-    
-    loadModel("../Models/viking_room_gltf/scene.gltf", glm::mat4(1.0f), meshes, instance.device_manager);
+
+    geometry_pool.init(sizeof(Vertex), sizeof(SkinInfluence));
+    texture_streamer.init(instance.frames_in_flight, 256ull << 20);
 
     glm::mat4 duck_mat = glm::mat4(1.0f);
     duck_mat = glm::translate(duck_mat, glm::vec3(0.0f, 10.0f, 0.0f));
     duck_mat = glm::scale(duck_mat, glm::vec3(0.02f));
-    loadModel("../Models/duck_gltf/Duck.gltf", duck_mat, meshes, instance.device_manager);
+
+    std::vector<ModelRequest> models = {
+        { "../Cooked/Models/viking_room_gltf/scene.gltf.mesh", glm::mat4(1.0f) },
+        { "../Cooked/Models/duck_gltf/Duck.gltf.mesh", duck_mat },
+    };
+    loadModels(models, meshes, skeletons, geometry_pool, texture_cache, instance.device_manager, instance.thread_pool, &texture_streamer);
 
     ShaderSettings shader_settings{};
     shader_settings.vert_addr = "../Shaders/vert.spv";
     shader_settings.frag_addr = "../Shaders/frag.spv";
-    shader_settings.binding_description = Vertex::getBindingDescription();
+    const auto& binding_descriptions = Vertex::getBindingDescriptions();
+    shader_settings.binding_descriptions = binding_descriptions.data();
+    shader_settings.binding_descriptions_count = binding_descriptions.size();
     const auto& attribute_descriptions = Vertex::getAttributeDescriptions();
     shader_settings.input_attribute_descriptions = attribute_descriptions.data();
     shader_settings.input_attribute_descriptions_count = attribute_descriptions.size();
 
+    // per draw data is pushed if it fits, the draw buffer is the fallback for devices (or payloads) where it doesn't.
+    // The fallback uses its own vertex shader variant, which doesn't declare the push constant block
+    {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(instance.device_manager.physicalDevice, &properties);
+        push_draw_data = !force_draw_buffer && sizeof(DrawData) <= properties.limits.maxPushConstantsSize;
+
+        if (push_draw_data)
+            shader_settings.push_constant_ranges.push_back({ VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(DrawData) });
+        else
+            shader_settings.vert_addr = "../Shaders/vert_draw_buffer.spv";
+    }
+
     {
         shader_settings.descriptor_set_layouts.resize(2);
 
-        // Proj view model mat
+        // Proj view mat, per draw data and skinning palettes
         {
+            // one set per frame in flight over the uniform ring, the frame's allocation is selected with a dynamic offset
             auto& layout = shader_settings.descriptor_set_layouts[0];
             layout.update_per_frame = true;
             layout.count = 1;
-            auto& binding = layout.bindings.emplace_back();
-            binding.stage_flags = VK_SHADER_STAGE_VERTEX_BIT;
-            binding.uniform_data_size = sizeof(ViewInfo);
-            binding.descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;   
+            layout.bindings.resize(3);
+
+            layout.bindings[0].stage_flags = VK_SHADER_STAGE_VERTEX_BIT;
+            layout.bindings[0].uniform_data_size = sizeof(ViewInfo);
+            layout.bindings[0].descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+
+            layout.bindings[1].stage_flags = VK_SHADER_STAGE_VERTEX_BIT;
+            layout.bindings[1].descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+            layout.bindings[2].stage_flags = VK_SHADER_STAGE_VERTEX_BIT;
+            layout.bindings[2].descriptor_type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
         }
 
-        // Texture sampler
+        // Bindless texture table
         {
             auto& layout = shader_settings.descriptor_set_layouts[1];
             layout.update_per_frame = false;
-            layout.count = meshes.size();
-            layout.bindings.resize(2);
+            layout.count = 1;
+            layout.bindings.resize(1);
 
             layout.bindings[0].stage_flags = VK_SHADER_STAGE_FRAGMENT_BIT;
             layout.bindings[0].descriptor_type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-
-            layout.bindings[1].stage_flags = VK_SHADER_STAGE_VERTEX_BIT;
-            layout.bindings[1].uniform_data_size = sizeof(ModelInfo);
-            layout.bindings[1].descriptor_type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            layout.bindings[0].descriptor_count = 4096;
+            layout.bindings[0].binding_flags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
         }
     }
 
-    // Create descriptor pool
-    instance.descriptor_pool.init(instance.device_manager.logicalDevice, instance.swapchain.images.size(), shader_settings.descriptor_set_layouts);
+    // Create descriptor pool, it grows as sets are allocated
+    instance.descriptor_pool.init(instance.device_manager.logicalDevice, instance.frames_in_flight);
 
     for (auto& layout : shader_settings.descriptor_set_layouts)
         layout.upload(instance.device_manager);
@@ -139,56 +290,71 @@ int main()
         //        uniform_data_size += binding.uniform_data_size;
         //}
 
-        uniform_buffers.resize(instance.swapchain.images.size() + meshes.size());
-        for (int i = 0; i < instance.swapchain.images.size(); ++ i)
+        uniform_ring.init(instance.device_manager, instance.frames_in_flight, 64 * 1024);
+
+        draw_buffers.resize(instance.frames_in_flight);
+        for (auto& buffer : draw_buffers)
+        {
+            buffer.init(instance.device_manager, std::max<size_t>(1, meshes.size()) * sizeof(DrawData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
+
+        uint32_t palette_size = 0;
+        for (const auto& skeleton : skeletons)
         {
-            uniform_buffers[i].init(instance.device_manager.physicalDevice, instance.device_manager.logicalDevice, sizeof(ViewInfo), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            palette_offsets.push_back(palette_size);
+            palette_size += skeleton.jointCount();
         }
 
-        for (int i = 0; i < meshes.size(); ++i)
+        palette_buffers.resize(instance.frames_in_flight);
+        for (auto& buffer : palette_buffers)
         {
-            uniform_buffers[i + instance.swapchain.images.size()].init(instance.device_manager.physicalDevice, instance.device_manager.logicalDevice, sizeof(ModelInfo), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+            buffer.init(instance.device_manager, std::max<size_t>(1, palette_size) * sizeof(glm::mat4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        }
+
+        pose_evaluator.init(instance.thread_pool.threadCount());
+        for (uint32_t k = 0; k < skeletons.size(); ++k)
+        {
+            Character& character = pose_evaluator.characters[pose_evaluator.addCharacter(k, palette_offsets[k])];
+            for (uint32_t clip = 0; clip < std::min<size_t>(2, skeletons[k].clips.size()); ++clip)
+                character.layers.push_back({ clip });
         }
     }
     
     instance.pipeline.init(instance.device_manager, instance.swapchain, shader_settings);
 
-    descriptor_sets.resize(instance.pipeline.swapchain_image_size + meshes.size());
-    std::vector<Buffer*> tmp_uniform_buffers(1);
-    std::vector<Texture*> tmp_textures(1);
-
-    for (int i = 0; i < instance.pipeline.swapchain_image_size; ++i)
+    // the per frame sets only differ in their draw and palette buffers, so they are allocated and written in one go
     {
-        tmp_uniform_buffers[0] = &uniform_buffers[i];
-        descriptor_sets[i] = instance.descriptor_pool.createDescriptorSet(instance.device_manager.logicalDevice, shader_settings.descriptor_set_layouts[0], tmp_uniform_buffers, tmp_textures);
-    }
+        const auto& layout = shader_settings.descriptor_set_layouts[0];
+        std::vector<DescriptorData> descriptor_data(instance.frames_in_flight * layout.written_binding_count);
+        for (uint32_t i = 0; i < instance.frames_in_flight; ++i)
+            fillDescriptorData(layout, { &uniform_ring.buffer, &draw_buffers[i], &palette_buffers[i] }, {}, &descriptor_data[i * layout.written_binding_count]);
 
-    for (int i = 0; i < meshes.size(); ++i) 
-    {
-        tmp_textures[0] = &meshes[i].texture;
-        tmp_uniform_buffers[0] = &uniform_buffers[instance.pipeline.swapchain_image_size + i];
-        descriptor_sets[i + instance.pipeline.swapchain_image_size] = instance.descriptor_pool.createDescriptorSet(instance.device_manager.logicalDevice, shader_settings.descriptor_set_layouts[1], tmp_uniform_buffers, tmp_textures);
+        frame_descriptor_sets.resize(instance.frames_in_flight);
+        instance.descriptor_pool.createDescriptorSets(layout, instance.frames_in_flight, descriptor_data.data(), frame_descriptor_sets.data());
     }
 
+    texture_table.init(instance.device_manager.logicalDevice, instance.descriptor_pool, shader_settings.descriptor_set_layouts[1], instance.frames_in_flight);
 
-    ModelInfo model_info{};
-    model_info.model = glm::mat4(1.0f);
-    for (int i = 0; i < meshes.size(); ++i) 
-    {
-        uploadData(uniform_buffers[instance.pipeline.swapchain_image_size + i], instance.device_manager.logicalDevice, &model_info);
-    }
+    if (compute_skinning)
+        skinning_pass.init(instance.device_manager, meshes);
     
     instance.mainLoop();
 
+    if (compute_skinning)
+        skinning_pass.deinit(instance.device_manager);
+    pose_evaluator.deinit();
+    texture_streamer.deinit(instance.device_manager);
+    texture_table.deinit();
     for (auto& mesh : meshes)
-    {
-        mesh.vertex_buffer.deinit(instance.device_manager.logicalDevice);
-        mesh.index_buffer.deinit(instance.device_manager.logicalDevice);
-        mesh.texture.deinit(instance.device_manager.logicalDevice);
-    }
-
-    for (auto& buffer : uniform_buffers)
-        buffer.deinit(instance.device_manager.logicalDevice);
+        texture_cache.release(instance.device_manager, mesh.texture);
+    texture_cache.deinit(instance.device_manager);
+    geometry_pool.deinit(instance.device_manager);
+
+    for (auto& buffer : draw_buffers)
+        buffer.deinit(instance.device_manager);
+    for (auto& buffer : palette_buffers)
+        buffer.deinit(instance.device_manager);
+    uniform_ring.deinit(instance.device_manager);
 
     for (auto& layout : shader_settings.descriptor_set_layouts)
         layout.deinit(instance.device_manager);
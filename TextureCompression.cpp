@@ -0,0 +1,352 @@
+#include "TextureCompression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    uint16_t packRGB565(const float* colour)
+    {
+        const uint32_t r = static_cast<uint32_t>(std::clamp(colour[0], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+        const uint32_t g = static_cast<uint32_t>(std::clamp(colour[1], 0.0f, 255.0f) * (63.0f / 255.0f) + 0.5f);
+        const uint32_t b = static_cast<uint32_t>(std::clamp(colour[2], 0.0f, 255.0f) * (31.0f / 255.0f) + 0.5f);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void unpackRGB565(uint16_t packed, int32_t* colour)
+    {
+        const int32_t r = (packed >> 11) & 31;
+        const int32_t g = (packed >> 5) & 63;
+        const int32_t b = packed & 31;
+        colour[0] = (r << 3) | (r >> 2);
+        colour[1] = (g << 2) | (g >> 4);
+        colour[2] = (b << 3) | (b >> 2);
+    }
+
+    void colourPalette(uint16_t c0, uint16_t c1, bool four_colours, int32_t palette[4][4])
+    {
+        unpackRGB565(c0, palette[0]);
+        unpackRGB565(c1, palette[1]);
+        palette[0][3] = palette[1][3] = 255;
+
+        for (int c = 0; c < 3; ++c)
+        {
+            if (four_colours)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c] + 1) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c] + 1) / 3;
+            }
+            else
+            {
+                palette[2][c] = (palette[0][c] + palette[1][c] + 1) / 2;
+                palette[3][c] = 0;
+            }
+        }
+        palette[2][3] = 255;
+        palette[3][3] = four_colours ? 255 : 0;
+    }
+
+    // endpoints along the principal axis of the block's colours, then the nearest palette entry per texel
+    void encodeColourBlock(const unsigned char* rgba, unsigned char* block)
+    {
+        float mean[3] = {};
+        for (int i = 0; i < 16; ++i)
+            for (int c = 0; c < 3; ++c)
+                mean[c] += rgba[i * 4 + c] * (1.0f / 16.0f);
+
+        float covariance[6] = {}; // rr rg rb gg gb bb
+        for (int i = 0; i < 16; ++i)
+        {
+            const float r = rgba[i * 4 + 0] - mean[0];
+            const float g = rgba[i * 4 + 1] - mean[1];
+            const float b = rgba[i * 4 + 2] - mean[2];
+            covariance[0] += r * r; covariance[1] += r * g; covariance[2] += r * b;
+            covariance[3] += g * g; covariance[4] += g * b; covariance[5] += b * b;
+        }
+
+        // power iteration, a handful of steps is plenty for a 3x3 matrix
+        float axis[3] = { 1.0f, 1.0f, 1.0f };
+        for (int iteration = 0; iteration < 8; ++iteration)
+        {
+            const float x = covariance[0] * axis[0] + covariance[1] * axis[1] + covariance[2] * axis[2];
+            const float y = covariance[1] * axis[0] + covariance[3] * axis[1] + covariance[4] * axis[2];
+            const float z = covariance[2] * axis[0] + covariance[4] * axis[1] + covariance[5] * axis[2];
+            const float length = std::sqrt(x * x + y * y + z * z);
+            if (length < 1e-6f)
+                break;
+            axis[0] = x / length;
+            axis[1] = y / length;
+            axis[2] = z / length;
+        }
+
+        float min_t = 0.0f, max_t = 0.0f;
+        for (int i = 0; i < 16; ++i)
+        {
+            const float t = (rgba[i * 4 + 0] - mean[0]) * axis[0] + (rgba[i * 4 + 1] - mean[1]) * axis[1] + (rgba[i * 4 + 2] - mean[2]) * axis[2];
+            min_t = std::min(min_t, t);
+            max_t = std::max(max_t, t);
+        }
+
+        float end0[3], end1[3];
+        for (int c = 0; c < 3; ++c)
+        {
+            end0[c] = mean[c] + axis[c] * max_t;
+            end1[c] = mean[c] + axis[c] * min_t;
+        }
+
+        uint16_t c0 = packRGB565(end0);
+        uint16_t c1 = packRGB565(end1);
+        // four colour mode needs c0 > c1, swapping the endpoints only mirrors the palette
+        if (c0 < c1)
+            std::swap(c0, c1);
+
+        uint32_t indices = 0;
+        if (c0 != c1)
+        {
+            int32_t palette[4][4];
+            colourPalette(c0, c1, true, palette);
+
+            for (int i = 0; i < 16; ++i)
+            {
+                uint32_t best = 0;
+                int32_t best_distance = INT32_MAX;
+                for (uint32_t p = 0; p < 4; ++p)
+                {
+                    const int32_t dr = rgba[i * 4 + 0] - palette[p][0];
+                    const int32_t dg = rgba[i * 4 + 1] - palette[p][1];
+                    const int32_t db = rgba[i * 4 + 2] - palette[p][2];
+                    const int32_t distance = dr * dr + dg * dg + db * db;
+                    if (distance < best_distance)
+                    {
+                        best_distance = distance;
+                        best = p;
+                    }
+                }
+                indices |= best << (i * 2);
+            }
+        }
+
+        block[0] = static_cast<unsigned char>(c0 & 0xFF);
+        block[1] = static_cast<unsigned char>(c0 >> 8);
+        block[2] = static_cast<unsigned char>(c1 & 0xFF);
+        block[3] = static_cast<unsigned char>(c1 >> 8);
+        for (int i = 0; i < 4; ++i)
+            block[4 + i] = static_cast<unsigned char>(indices >> (i * 8));
+    }
+
+    void decodeColourBlock(const unsigned char* block, unsigned char* rgba, bool always_four_colours)
+    {
+        const uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+        const uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+
+        int32_t palette[4][4];
+        colourPalette(c0, c1, always_four_colours || c0 > c1, palette);
+
+        const uint32_t indices = block[4] | (block[5] << 8) | (block[6] << 16) | (uint32_t(block[7]) << 24);
+        for (int i = 0; i < 16; ++i)
+        {
+            const uint32_t index = (indices >> (i * 2)) & 3;
+            for (int c = 0; c < 4; ++c)
+                rgba[i * 4 + c] = static_cast<unsigned char>(palette[index][c]);
+        }
+    }
+
+    void alphaPalette(uint32_t a0, uint32_t a1, uint32_t palette[8])
+    {
+        palette[0] = a0;
+        palette[1] = a1;
+        if (a0 > a1)
+        {
+            for (uint32_t i = 1; i < 7; ++i)
+                palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+        }
+        else
+        {
+            for (uint32_t i = 1; i < 5; ++i)
+                palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    void encodeAlphaBlock(const unsigned char* rgba, unsigned char* block)
+    {
+        uint32_t a0 = 0, a1 = 255;
+        for (int i = 0; i < 16; ++i)
+        {
+            a0 = std::max<uint32_t>(a0, rgba[i * 4 + 3]);
+            a1 = std::min<uint32_t>(a1, rgba[i * 4 + 3]);
+        }
+
+        uint64_t indices = 0;
+        if (a0 != a1)
+        {
+            uint32_t palette[8];
+            alphaPalette(a0, a1, palette);
+
+            for (int i = 0; i < 16; ++i)
+            {
+                uint64_t best = 0;
+                int32_t best_distance = INT32_MAX;
+                for (uint32_t p = 0; p < 8; ++p)
+                {
+                    const int32_t distance = std::abs(int32_t(rgba[i * 4 + 3]) - int32_t(palette[p]));
+                    if (distance < best_distance)
+                    {
+                        best_distance = distance;
+                        best = p;
+                    }
+                }
+                indices |= best << (i * 3);
+            }
+        }
+
+        block[0] = static_cast<unsigned char>(a0);
+        block[1] = static_cast<unsigned char>(a1);
+        for (int i = 0; i < 6; ++i)
+            block[2 + i] = static_cast<unsigned char>(indices >> (i * 8));
+    }
+
+    void decodeAlphaBlock(const unsigned char* block, unsigned char* rgba)
+    {
+        uint32_t palette[8];
+        alphaPalette(block[0], block[1], palette);
+
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; ++i)
+            indices |= uint64_t(block[2 + i]) << (i * 8);
+
+        for (int i = 0; i < 16; ++i)
+            rgba[i * 4 + 3] = static_cast<unsigned char>(palette[(indices >> (i * 3)) & 7]);
+    }
+}
+
+bool formatBlockInfo(VkFormat format, FormatBlockInfo& info)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        info = { 1, 1, 4 };
+        return true;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        info = { 4, 4, 8 };
+        return true;
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+        info = { 4, 4, 16 };
+        return true;
+    default:
+        return false;
+    }
+}
+
+bool isBlockCompressed(VkFormat format)
+{
+    FormatBlockInfo info;
+    return formatBlockInfo(format, info) && info.block_width > 1;
+}
+
+size_t textureLevelSize(VkFormat format, uint32_t width, uint32_t height, uint32_t level)
+{
+    FormatBlockInfo info;
+    if (!formatBlockInfo(format, info))
+        return 0;
+
+    const size_t level_width = std::max(1u, width >> level);
+    const size_t level_height = std::max(1u, height >> level);
+    return ((level_width + info.block_width - 1) / info.block_width) * ((level_height + info.block_height - 1) / info.block_height) * info.block_bytes;
+}
+
+void encodeBC1Block(const unsigned char* rgba, unsigned char* block)
+{
+    encodeColourBlock(rgba, block);
+}
+
+void encodeBC3Block(const unsigned char* rgba, unsigned char* block)
+{
+    encodeAlphaBlock(rgba, block);
+    encodeColourBlock(rgba, block + 8);
+}
+
+void decodeBC1Block(const unsigned char* block, unsigned char* rgba)
+{
+    decodeColourBlock(block, rgba, false);
+}
+
+void decodeBC3Block(const unsigned char* block, unsigned char* rgba)
+{
+    decodeColourBlock(block + 8, rgba, true);
+    decodeAlphaBlock(block, rgba);
+}
+
+void compressImage(VkFormat format, const unsigned char* rgba, uint32_t width, uint32_t height, unsigned char* blocks)
+{
+    if (!isBlockCompressed(format))
+    {
+        memcpy(blocks, rgba, size_t(width) * height * 4);
+        return;
+    }
+
+    const bool bc3 = format == VK_FORMAT_BC3_SRGB_BLOCK;
+    const size_t block_bytes = bc3 ? 16 : 8;
+
+    unsigned char texels[16 * 4];
+    for (uint32_t by = 0; by < height; by += 4)
+    {
+        for (uint32_t bx = 0; bx < width; bx += 4)
+        {
+            for (uint32_t y = 0; y < 4; ++y)
+            {
+                const uint32_t sy = std::min(by + y, height - 1);
+                for (uint32_t x = 0; x < 4; ++x)
+                {
+                    const uint32_t sx = std::min(bx + x, width - 1);
+                    memcpy(texels + (y * 4 + x) * 4, rgba + (size_t(sy) * width + sx) * 4, 4);
+                }
+            }
+
+            if (bc3)
+                encodeBC3Block(texels, blocks);
+            else
+                encodeBC1Block(texels, blocks);
+            blocks += block_bytes;
+        }
+    }
+}
+
+bool decompressImage(VkFormat format, const unsigned char* blocks, uint32_t width, uint32_t height, unsigned char* rgba)
+{
+    if (format != VK_FORMAT_BC1_RGB_SRGB_BLOCK && format != VK_FORMAT_BC1_RGBA_SRGB_BLOCK && format != VK_FORMAT_BC3_SRGB_BLOCK)
+        return false;
+
+    const bool bc3 = format == VK_FORMAT_BC3_SRGB_BLOCK;
+    const bool opaque = format == VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+    const size_t block_bytes = bc3 ? 16 : 8;
+
+    unsigned char texels[16 * 4];
+    for (uint32_t by = 0; by < height; by += 4)
+    {
+        for (uint32_t bx = 0; bx < width; bx += 4)
+        {
+            if (bc3)
+                decodeBC3Block(blocks, texels);
+            else
+                decodeBC1Block(blocks, texels);
+            blocks += block_bytes;
+
+            for (uint32_t y = 0; y < 4 && by + y < height; ++y)
+            {
+                for (uint32_t x = 0; x < 4 && bx + x < width; ++x)
+                {
+                    unsigned char* out = rgba + (size_t(by + y) * width + bx + x) * 4;
+                    memcpy(out, texels + (y * 4 + x) * 4, 4);
+                    if (opaque)
+                        out[3] = 255;
+                }
+            }
+        }
+    }
+
+    return true;
+}
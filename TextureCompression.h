@@ -0,0 +1,35 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <cstdint>
+#include <cstddef>
+
+// The texel formats textures are stored in: RGBA8 and the BC1/BC3 block formats the asset cooker compresses to.
+// BC is encoded in sRGB space like the hardware interpolates it, the decoders are the fallback for GPUs without BC support.
+
+struct FormatBlockInfo
+{
+    uint32_t block_width;
+    uint32_t block_height;
+    uint32_t block_bytes;
+};
+
+// false for formats textures can't be stored in
+bool formatBlockInfo(VkFormat format, FormatBlockInfo& info);
+bool isBlockCompressed(VkFormat format);
+
+// bytes of one mip level, level 0 being width x height
+size_t textureLevelSize(VkFormat format, uint32_t width, uint32_t height, uint32_t level);
+
+// 4x4 blocks, rgba is 16 texels in row order. BC1 always uses the opaque four colour mode
+void encodeBC1Block(const unsigned char* rgba, unsigned char* block);
+void encodeBC3Block(const unsigned char* rgba, unsigned char* block);
+void decodeBC1Block(const unsigned char* block, unsigned char* rgba);
+void decodeBC3Block(const unsigned char* block, unsigned char* rgba);
+
+// whole images, edge blocks of sizes that aren't a multiple of 4 repeat the last row/column
+void compressImage(VkFormat format, const unsigned char* rgba, uint32_t width, uint32_t height, unsigned char* blocks);
+// returns false for formats there is no decoder for
+bool decompressImage(VkFormat format, const unsigned char* blocks, uint32_t width, uint32_t height, unsigned char* rgba);
@@ -0,0 +1,307 @@
+#include "TextureStreamer.h"
+
+#include "MipGenerator.h"
+#include "TextureCompression.h"
+#include "VulkanWrapper/Log.h"
+#include "VulkanWrapper/UploadBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+void TextureStreamer::init(uint32_t frames_in_flight, VkDeviceSize budget)
+{
+    this->frames_in_flight = frames_in_flight;
+    this->budget = budget;
+
+    // one thread is enough to keep ahead of the uploads, and keeps page faults from competing with frame recording
+    io_thread.init(1);
+}
+
+void TextureStreamer::deinit(DeviceManager& device_manager)
+{
+    while (!textures.empty())
+        remove(device_manager, textures.begin()->first);
+
+    io_thread.deinit();
+
+    for (RetiredImage& retired_image : retired)
+        retired_image.image.deinit(device_manager);
+    retired.clear();
+}
+
+uint32_t TextureStreamer::tailLevel(const CookedTexture& source) const
+{
+    uint32_t level = 0;
+    while (level + 1 < source.level_count && std::max(source.width >> level, source.height >> level) > tail_size)
+        ++level;
+    return level;
+}
+
+void TextureStreamer::add(DeviceManager& device_manager, Texture* texture, CookedTexture& source)
+{
+    auto& streamed = textures[texture];
+    if (streamed)
+    {
+        log_warning(("texture " + texture->path + " is already streamed\n").c_str());
+        return;
+    }
+
+    streamed = std::make_unique<StreamedTexture>();
+    streamed->texture = texture;
+
+    // the mapping moves over, closing the emptied source only resets its fields
+    streamed->source = source;
+    source.file = MappedFile{};
+    source.close();
+
+    streamed->decompress = isBlockCompressed(streamed->source.format) && !supportsCompressedFormat(device_manager, streamed->source.format);
+    streamed->tail_level = tailLevel(streamed->source);
+    streamed->resident_level = streamed->tail_level;
+    streamed->wanted_level = streamed->tail_level;
+
+    committed_bytes += residentSize(*streamed, streamed->resident_level);
+}
+
+void TextureStreamer::remove(DeviceManager& device_manager, Texture* texture)
+{
+    auto found = textures.find(texture);
+    if (found == textures.end())
+        return;
+
+    StreamedTexture& streamed = *found->second;
+
+    // a change in flight still references the mapping, and its image has to be destroyed once the GPU is done with it
+    if (streamed.state == State::Preparing)
+    {
+        while (!streamed.prepared.load(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+    else if (streamed.state == State::Uploading)
+    {
+        device_manager.upload_queue.wait(device_manager, streamed.pending_upload);
+        streamed.pending_image.deinit(device_manager);
+    }
+
+    committed_bytes -= residentSize(streamed, streamed.state == State::Idle ? streamed.resident_level : streamed.pending_level);
+
+    streamed.source.close();
+    textures.erase(found);
+}
+
+void TextureStreamer::request(Texture* texture, float screen_size)
+{
+    auto found = textures.find(texture);
+    if (found == textures.end())
+        return;
+
+    StreamedTexture& streamed = *found->second;
+
+    // one texel per covered pixel, assuming the texture is mapped once across the object
+    const float texture_size = static_cast<float>(std::max(streamed.source.width, streamed.source.height));
+    uint32_t level = streamed.tail_level;
+    if (screen_size >= 1.0f)
+        level = static_cast<uint32_t>(std::max(0.0f, std::floor(std::log2(texture_size / screen_size))));
+
+    streamed.wanted_level = std::min({ streamed.wanted_level, level, streamed.tail_level });
+}
+
+void TextureStreamer::update(DeviceManager& device_manager)
+{
+    ++frame;
+
+    // every frame that could still sample these has finished
+    for (size_t i = 0; i < retired.size();)
+    {
+        if (frame >= retired[i].frame + frames_in_flight)
+        {
+            retired[i].image.deinit(device_manager);
+            retired[i] = retired.back();
+            retired.pop_back();
+        }
+        else
+            ++i;
+    }
+
+    struct Change
+    {
+        StreamedTexture* streamed;
+        uint32_t level;
+    };
+    std::vector<Change> grow;
+    std::vector<Change> shrink;
+    std::vector<StreamedTexture*> uploading;
+    uint32_t changes_in_flight = 0;
+
+    UploadBatch upload_batch;
+    bool batch_begun = false;
+
+    for (auto& [texture, streamed_ptr] : textures)
+    {
+        StreamedTexture& streamed = *streamed_ptr;
+
+        if (streamed.state == State::Uploading && device_manager.upload_queue.isComplete(streamed.pending_upload))
+        {
+            retired.push_back({ texture->image, frame });
+            texture->image = streamed.pending_image;
+            streamed.pending_image = {};
+            ++texture->generation;
+
+            streamed.resident_level = streamed.pending_level;
+            streamed.state = State::Idle;
+            std::vector<unsigned char>().swap(streamed.decompressed);
+        }
+        else if (streamed.state == State::Preparing && streamed.prepared.load(std::memory_order_acquire))
+        {
+            if (!batch_begun)
+            {
+                upload_batch.begin(device_manager);
+                batch_begun = true;
+            }
+
+            const CookedTexture& source = streamed.source;
+            TextureData texture_data{};
+            texture_data.width = std::max(1u, source.width >> streamed.pending_level);
+            texture_data.height = std::max(1u, source.height >> streamed.pending_level);
+            texture_data.format = streamed.decompress ? VK_FORMAT_R8G8B8A8_SRGB : source.format;
+            texture_data.level_count = source.level_count - streamed.pending_level;
+            for (uint32_t level = 0; level < texture_data.level_count; ++level)
+            {
+                if (streamed.decompress)
+                    texture_data.levels[level] = { streamed.decompressed.data() + mipChainSize(texture_data.width, texture_data.height, level), textureLevelSize(VK_FORMAT_R8G8B8A8_SRGB, texture_data.width, texture_data.height, level) };
+                else
+                    texture_data.levels[level] = { source.levels[streamed.pending_level + level].data, source.levels[streamed.pending_level + level].size };
+            }
+
+            uploadTextureData(upload_batch, streamed.pending_image, texture_data);
+            streamed.state = State::Uploading;
+            uploading.push_back(&streamed);
+        }
+
+        if (streamed.state != State::Idle)
+        {
+            ++changes_in_flight;
+        }
+        else
+        {
+            const uint32_t level = streamed.wanted_level;
+            if (level < streamed.resident_level)
+                grow.push_back({ &streamed, level });
+            else if (level > streamed.resident_level)
+                shrink.push_back({ &streamed, level });
+        }
+
+        for (uint32_t level = streamed.wanted_level; level < streamed.source.level_count; ++level)
+            streamed.last_needed_frame[level] = frame;
+
+        // requests are collected afresh every frame
+        streamed.wanted_level = streamed.tail_level;
+    }
+
+    if (batch_begun)
+    {
+        const UploadToken token = upload_batch.submit();
+        for (StreamedTexture* streamed : uploading)
+            streamed->pending_upload = token;
+    }
+
+    // the most starved textures grow first, the least recently needed levels are the first to go
+    std::sort(grow.begin(), grow.end(), [](const Change& a, const Change& b) { return a.streamed->resident_level - a.level > b.streamed->resident_level - b.level; });
+    std::sort(shrink.begin(), shrink.end(), [](const Change& a, const Change& b) { return a.streamed->last_needed_frame[a.streamed->resident_level] < b.streamed->last_needed_frame[b.streamed->resident_level]; });
+
+    size_t next_shrink = 0;
+    auto evict = [&]()
+    {
+        if (next_shrink == shrink.size() || changes_in_flight >= max_changes_in_flight)
+            return false;
+
+        const Change& change = shrink[next_shrink++];
+        committed_bytes -= residentSize(*change.streamed, change.streamed->resident_level) - residentSize(*change.streamed, change.level);
+        beginChange(*change.streamed, change.level);
+        ++changes_in_flight;
+        return true;
+    };
+
+    while (committed_bytes > budget && evict()) {}
+
+    for (const Change& change : grow)
+    {
+        if (changes_in_flight >= max_changes_in_flight)
+            break;
+
+        StreamedTexture& streamed = *change.streamed;
+        const VkDeviceSize current_size = residentSize(streamed, streamed.resident_level);
+
+        while (committed_bytes + residentSize(streamed, change.level) - current_size > budget && evict()) {}
+
+        // settle for the finest level that fits if evicting wasn't enough
+        uint32_t level = change.level;
+        while (level < streamed.resident_level && committed_bytes + residentSize(streamed, level) - current_size > budget)
+            ++level;
+        if (level == streamed.resident_level)
+            continue;
+
+        committed_bytes += residentSize(streamed, level) - current_size;
+        beginChange(streamed, level);
+        ++changes_in_flight;
+    }
+}
+
+VkDeviceSize TextureStreamer::residentSize(const StreamedTexture& streamed, uint32_t first_level) const
+{
+    const VkFormat format = streamed.decompress ? VK_FORMAT_R8G8B8A8_SRGB : streamed.source.format;
+
+    VkDeviceSize size = 0;
+    for (uint32_t level = first_level; level < streamed.source.level_count; ++level)
+        size += textureLevelSize(format, streamed.source.width, streamed.source.height, level);
+    return size;
+}
+
+void TextureStreamer::beginChange(StreamedTexture& streamed, uint32_t level)
+{
+    streamed.state = State::Preparing;
+    streamed.pending_level = level;
+    streamed.pending_upload = {};
+    streamed.prepared.store(false, std::memory_order_relaxed);
+
+    StreamedTexture* target = &streamed;
+    io_thread.submit([target](uint32_t thread_index)
+    {
+        const CookedTexture& source = target->source;
+
+        if (target->decompress)
+        {
+            const uint32_t width = std::max(1u, source.width >> target->pending_level);
+            const uint32_t height = std::max(1u, source.height >> target->pending_level);
+            const uint32_t level_count = source.level_count - target->pending_level;
+
+            target->decompressed.resize(mipChainSize(width, height, level_count));
+            for (uint32_t level = 0; level < level_count; ++level)
+                decompressImage(source.format, source.levels[target->pending_level + level].data, std::max(1u, width >> level), std::max(1u, height >> level), target->decompressed.data() + mipChainSize(width, height, level));
+        }
+        else
+        {
+            // fault the new levels in here rather than on the main thread when they are copied into staging memory
+            volatile unsigned char touched = 0;
+            for (uint32_t level = target->pending_level; level < target->resident_level; ++level)
+            {
+                for (size_t offset = 0; offset < source.levels[level].size; offset += 4096)
+                    touched = touched ^ source.levels[level].data[offset];
+            }
+        }
+
+        target->prepared.store(true, std::memory_order_release);
+    });
+}
+
+float projectedSize(const glm::vec3& view_center, float radius, float proj_scale, float viewport_height)
+{
+    // view space looks down -z
+    const float distance = -view_center.z;
+    if (distance < -radius)
+        return 0.0f;
+    if (distance <= radius)
+        return viewport_height;
+
+    return radius / distance * proj_scale * viewport_height;
+}
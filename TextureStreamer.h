@@ -0,0 +1,98 @@
+#pragma once
+
+#include "CookedTexture.h"
+#include "ThreadPool.h"
+#include "VulkanWrapper/DeviceManager.h"
+#include "VulkanWrapper/Image.h"
+#include "VulkanWrapper/UploadQueue.h"
+
+#include "glm/glm.hpp"
+
+#include <atomic>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+using namespace VulkanWrapper;
+
+// Streams the upper mip levels of cooked textures in and out of VRAM. A streamed texture is created with only its
+// mip tail, then every frame the renderer reports how large each texture appears on screen and the streamer grows
+// or shrinks the resident levels to match. Once over budget, the least recently needed levels are evicted.
+//
+// There are no partially resident images in Vulkan 1.0, so a residency change uploads a new image holding exactly
+// the resident levels and swaps it into the Texture once the upload has completed. Sampling a level that isn't
+// loaded is impossible by construction, the image view simply starts at the finest resident level.
+struct TextureStreamer
+{
+    enum class State
+    {
+        Idle,
+        Preparing, // the IO thread pages in (or decompresses) the level data
+        Uploading,
+    };
+
+    struct StreamedTexture
+    {
+        Texture* texture = nullptr;
+        CookedTexture source; // stays mapped for as long as the texture streams
+        bool decompress = false; // the device can't sample the source format, levels are uploaded as RGBA8
+
+        uint32_t resident_level = 0; // source level of texture->image's level 0
+        uint32_t tail_level = 0; // levels from here on are resident from the start and never evicted
+        uint32_t wanted_level = 0; // finest level requested since the last update
+        uint64_t last_needed_frame[CookedTexture::max_levels] = {};
+
+        State state = State::Idle;
+        uint32_t pending_level = 0;
+        std::atomic<bool> prepared{ false };
+        std::vector<unsigned char> decompressed; // RGBA8 levels [pending_level, level_count) packed as in MipGenerator.h
+        Image pending_image{};
+        UploadToken pending_upload;
+    };
+
+    struct RetiredImage
+    {
+        Image image;
+        uint64_t frame; // destroyed once every frame that could have sampled it has finished
+    };
+
+    VkDeviceSize budget = 256ull << 20;
+    uint32_t tail_size = 128; // levels no larger than this are always resident
+    uint32_t max_changes_in_flight = 4;
+
+    uint32_t frames_in_flight = 2;
+    uint64_t frame = 0;
+    VkDeviceSize committed_bytes = 0; // resident levels, counting changes in flight at their new size
+
+    std::unordered_map<Texture*, std::unique_ptr<StreamedTexture>> textures;
+    std::vector<RetiredImage> retired;
+    ThreadPool io_thread;
+
+    void init(uint32_t frames_in_flight, VkDeviceSize budget);
+    void deinit(DeviceManager& device_manager);
+
+    // first level of source a streamed texture is created from, 0 if it is small enough to not be worth streaming
+    uint32_t tailLevel(const CookedTexture& source) const;
+
+    // texture must have been created from source's levels [tailLevel(source), level_count).
+    // Takes over source's mapping, leaving source empty
+    void add(DeviceManager& device_manager, Texture* texture, CookedTexture& source);
+
+    // stops streaming the texture, call before the texture cache releases it
+    void remove(DeviceManager& device_manager, Texture* texture);
+
+    // screen_size is how many pixels the texture's longest side covers on screen, see projectedSize. Textures that
+    // aren't requested in a frame count as not needed beyond their tail
+    void request(Texture* texture, float screen_size);
+
+    // once per frame on the main thread, after the frame's fence has been waited on. Swapped textures get a new
+    // generation, which must be picked up before anything samples them this frame
+    void update(DeviceManager& device_manager);
+
+private:
+    VkDeviceSize residentSize(const StreamedTexture& streamed, uint32_t first_level) const;
+    void beginChange(StreamedTexture& streamed, uint32_t level);
+};
+
+// approximate on-screen diameter in pixels of a sphere, view_center in view space and proj_scale being proj[1][1]
+float projectedSize(const glm::vec3& view_center, float radius, float proj_scale, float viewport_height);
@@ -0,0 +1,99 @@
+#include "ThreadPool.h"
+
+#include <algorithm>
+
+void ThreadPool::init(uint32_t worker_count)
+{
+    if (worker_count == 0)
+        worker_count = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+    stopping = false;
+    for (uint32_t i = 0; i < worker_count; ++i)
+        workers.emplace_back(&ThreadPool::workerLoop, this, i + 1);
+}
+
+void ThreadPool::deinit()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    job_available.notify_all();
+
+    for (auto& worker : workers)
+        worker.join();
+    workers.clear();
+}
+
+void ThreadPool::submit(Job job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(std::move(job));
+        ++jobs_in_flight;
+    }
+    job_available.notify_one();
+}
+
+bool ThreadPool::runOne(uint32_t thread_index, std::unique_lock<std::mutex>& lock)
+{
+    if (jobs.empty())
+        return false;
+
+    Job job = std::move(jobs.front());
+    jobs.pop_front();
+
+    lock.unlock();
+    job(thread_index);
+    lock.lock();
+
+    if (--jobs_in_flight == 0)
+        jobs_finished.notify_all();
+
+    return true;
+}
+
+void ThreadPool::workerLoop(uint32_t thread_index)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        job_available.wait(lock, [this]() { return stopping || !jobs.empty(); });
+        if (stopping)
+            return;
+
+        runOne(thread_index, lock);
+    }
+}
+
+void ThreadPool::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (runOne(0, lock)) {}
+
+    jobs_finished.wait(lock, [this]() { return jobs_in_flight == 0; });
+}
+
+void ThreadPool::parallelFor(size_t count, const std::function<void(size_t index, uint32_t thread_index)>& task)
+{
+    if (count == 0)
+        return;
+
+    // single items run inline, there is nothing to overlap with
+    if (count == 1 || workers.empty())
+    {
+        for (size_t i = 0; i < count; ++i)
+            task(i, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t i = 0; i < count; ++i)
+            jobs.push_back([&task, i](uint32_t thread_index) { task(i, thread_index); });
+        jobs_in_flight += count;
+    }
+    job_available.notify_all();
+
+    wait();
+}
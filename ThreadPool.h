@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+// Fixed set of worker threads fed from a single job queue. Each worker has a stable thread index
+// (the calling thread is 0) so jobs can use per-thread resources such as command pools without locking.
+struct ThreadPool
+{
+    using Job = std::function<void(uint32_t thread_index)>;
+
+    std::vector<std::thread> workers;
+    std::deque<Job> jobs;
+    size_t jobs_in_flight = 0; // queued plus running
+
+    std::mutex mutex;
+    std::condition_variable job_available;
+    std::condition_variable jobs_finished;
+    bool stopping = false;
+
+    // worker_count 0 uses one worker per hardware thread besides the caller
+    void init(uint32_t worker_count = 0);
+    void deinit();
+
+    // workers plus the calling thread, i.e. the range of thread indices passed to jobs
+    uint32_t threadCount() const { return static_cast<uint32_t>(workers.size()) + 1; }
+
+    void submit(Job job);
+
+    // the calling thread helps with queued jobs until every submitted job has finished,
+    // only call this (and parallelFor) from the thread that owns the pool as it runs jobs as thread 0
+    void wait();
+
+    // runs task(i, thread_index) for every i in [0, count) and returns once all have finished
+    void parallelFor(size_t count, const std::function<void(size_t index, uint32_t thread_index)>& task);
+
+private:
+    void workerLoop(uint32_t thread_index);
+    bool runOne(uint32_t thread_index, std::unique_lock<std::mutex>& lock);
+};
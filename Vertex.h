@@ -3,6 +3,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include "glm/glm.hpp"
+#include "Skeleton.h"
 
 #include <array>
 
@@ -17,19 +18,24 @@ struct Vertex
         return pos == other.pos && colour == other.colour && texCoord == other.texCoord;
     }
 
-    static VkVertexInputBindingDescription getBindingDescription()
+    // binding 1 is the SkinInfluence stream, which static meshes leave unread
+    static std::array<VkVertexInputBindingDescription, 2> getBindingDescriptions()
     {
-        VkVertexInputBindingDescription bindingDescription{};
-        bindingDescription.binding = 0;
-        bindingDescription.stride = sizeof(Vertex);
-        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-        return bindingDescription;
+        static std::array<VkVertexInputBindingDescription, 2> bindingDescriptions{};
+        bindingDescriptions[0].binding = 0;
+        bindingDescriptions[0].stride = sizeof(Vertex);
+        bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+        bindingDescriptions[1].binding = 1;
+        bindingDescriptions[1].stride = sizeof(SkinInfluence);
+        bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        return bindingDescriptions;
     }
 
-    static std::array<VkVertexInputAttributeDescription, 3> getAttributeDescriptions()
+    static std::array<VkVertexInputAttributeDescription, 5> getAttributeDescriptions()
     {
         // one for pos one for colour
-        static std::array<VkVertexInputAttributeDescription, 3> attributeDescriptions{};
+        static std::array<VkVertexInputAttributeDescription, 5> attributeDescriptions{};
         attributeDescriptions[0].binding = 0;
         attributeDescriptions[0].location = 0;
         attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
@@ -45,6 +51,16 @@ struct Vertex
         attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
         attributeDescriptions[2].offset = offsetof(Vertex, texCoord);
 
+        attributeDescriptions[3].binding = 1;
+        attributeDescriptions[3].location = 3;
+        attributeDescriptions[3].format = VK_FORMAT_R8G8B8A8_UINT;
+        attributeDescriptions[3].offset = offsetof(SkinInfluence, joints);
+
+        attributeDescriptions[4].binding = 1;
+        attributeDescriptions[4].location = 4;
+        attributeDescriptions[4].format = VK_FORMAT_R16G16B16A16_UNORM;
+        attributeDescriptions[4].offset = offsetof(SkinInfluence, weights);
+
         return attributeDescriptions;
     }
 };
\ No newline at end of file
@@ -24,8 +24,6 @@ VKAPI_ATTR VkBool32 VKAPI_CALL debug_callback(VkDebugUtilsMessageSeverityFlagBit
     return VK_FALSE;
 }
 
-const int MAX_FRAMES_IN_FLIGHT = 2;
-
 std::vector<const char*> getRequiredExtensions()
 {
     std::vector<const char*> extensions;
@@ -116,7 +114,7 @@ void VulkanInstance::init()
     appInfo.applicationVersion = VK_MAKE_VERSION(0, 0, 1);
     appInfo.pEngineName = "custom";
     appInfo.engineVersion = VK_MAKE_VERSION(0, 0, 1);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_2;
 
     if (!checkValidationLayerSupport())
         log_error("Validation layers not supported!");
@@ -157,9 +155,9 @@ void VulkanInstance::init()
 
     // Create sync objects
     {
-        image_available_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        render_finished_semaphores.resize(MAX_FRAMES_IN_FLIGHT);
-        frame_finished_fences.resize(MAX_FRAMES_IN_FLIGHT);
+        image_available_semaphores.resize(frames_in_flight);
+        render_finished_semaphores.resize(frames_in_flight);
+        frame_finished_fences.resize(frames_in_flight);
         image_to_frame_fences.resize(swapchain.images.size(), VK_NULL_HANDLE);
 
         // similar to fences but can only be used within or across queues
@@ -170,7 +168,7 @@ void VulkanInstance::init()
         fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
         fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-        for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; ++i)
+        for (size_t i = 0; i < frames_in_flight; ++i)
         {
             if (vkCreateSemaphore(device_manager.logicalDevice, &semaphoreInfo, nullptr, &image_available_semaphores[i]) != VK_SUCCESS)
                 log_error("failed to create synchronisation objects for a frame!");
@@ -182,17 +180,25 @@ void VulkanInstance::init()
                 log_error("failed to create synchronisation objects for a frame!");
         }
     }
+
+    command_buffer_set.init(device_manager, frames_in_flight);
+
+    thread_pool.init();
+    secondary_command_buffers.init(device_manager, frames_in_flight, thread_pool.threadCount());
 }
 
 void VulkanInstance::deinit()
 {
+    thread_pool.deinit();
+
     command_buffer_set.deinit(device_manager);
+    secondary_command_buffers.deinit(device_manager);
 
     pipeline.deinit(device_manager, false);
     descriptor_pool.deinit(device_manager.logicalDevice);
     swapchain.deinit(device_manager);
 
-    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
+    for (size_t i = 0; i < frames_in_flight; i++)
     {
         vkDestroySemaphore(device_manager.logicalDevice, render_finished_semaphores[i], nullptr);
         vkDestroySemaphore(device_manager.logicalDevice, image_available_semaphores[i], nullptr);
@@ -216,47 +222,86 @@ void VulkanInstance::deinit()
     glfwTerminate();
 }
 
-void VulkanInstance::createCommandBuffers()
+void VulkanInstance::recordCommandBuffer(size_t frame_index, uint32_t image_index)
 {
-    command_buffer_set.init(device_manager, pipeline.framebuffers.size());
+    // the frame fence has been waited on, so the previous recording of this buffer is no longer in use
+    command_buffer_set.begin(frame_index, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+
+    if (pre_pass_callback)
+        pre_pass_callback(frame_index, command_buffer_set[frame_index]);
+
+    VkRenderPassBeginInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    renderPassInfo.renderPass = pipeline.render_pass;
+    renderPassInfo.framebuffer = pipeline.framebuffers[image_index];
+    renderPassInfo.renderArea.offset = { 0, 0 };
+    renderPassInfo.renderArea.extent = swapchain.extent;
+    std::array<VkClearValue, 2> clearValues{};
+    clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
+    clearValues[1].depthStencil = { 1.0f, 0 };
+    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
+    renderPassInfo.pClearValues = clearValues.data();
+
+    if (!draw_range_callback)
+    {
+        // no error handling from here while recording
+        vkCmdBeginRenderPass(command_buffer_set[frame_index], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBindPipeline(command_buffer_set[frame_index], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.graphics_pipeline);
 
-    for (size_t i = 0; i < command_buffer_set.size(); ++i)
+        command_buffer_callback(pipeline, frame_index, command_buffer_set[frame_index]);
+
+        vkCmdEndRenderPass(command_buffer_set[frame_index]);
+    }
+    else
     {
-        command_buffer_set.begin(i, 0);
-
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = pipeline.render_pass;
-        renderPassInfo.framebuffer = pipeline.framebuffers[i];
-        renderPassInfo.renderArea.offset = { 0, 0 };
-        renderPassInfo.renderArea.extent = swapchain.extent;
-        std::array<VkClearValue, 2> clearValues{};
-        clearValues[0].color = { 0.0f, 0.0f, 0.0f, 1.0f };
-        clearValues[1].depthStencil = { 1.0f, 0 };
-        renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-        renderPassInfo.pClearValues = clearValues.data();
+        secondary_command_buffers.reset(device_manager, frame_index);
 
-        // no error handling from here while recording
-        vkCmdBeginRenderPass(command_buffer_set[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-        vkCmdBindPipeline(command_buffer_set[i], VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.graphics_pipeline);
+        const size_t draw_count = draw_count_callback(frame_index);
+        const size_t task_count = (draw_count + draws_per_task - 1) / draws_per_task;
 
-        command_buffer_callback(pipeline, i, command_buffer_set[i]);
+        VkCommandBufferInheritanceInfo inheritance{};
+        inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        inheritance.renderPass = pipeline.render_pass;
+        inheritance.subpass = 0;
+        inheritance.framebuffer = pipeline.framebuffers[image_index];
 
-        vkCmdEndRenderPass(command_buffer_set[i]);
+        // one secondary buffer per task, executed in task order so the draw order is unchanged
+        std::vector<VkCommandBuffer> secondaries(task_count);
+        thread_pool.parallelFor(task_count, [&](size_t task_index, uint32_t thread_index)
+        {
+            VkCommandBuffer command_buffer = secondary_command_buffers.begin(device_manager, frame_index, thread_index, inheritance);
 
-        command_buffer_set.end();
+            // secondary command buffers inherit no state from the primary
+            vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.graphics_pipeline);
+
+            const size_t first_draw = task_index * draws_per_task;
+            draw_range_callback(pipeline, frame_index, first_draw, std::min(draws_per_task, draw_count - first_draw), command_buffer);
+
+            if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+                log_error("failed to record secondary command buffer!");
+
+            secondaries[task_index] = command_buffer;
+        });
+
+        vkCmdBeginRenderPass(command_buffer_set[frame_index], &renderPassInfo, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+        if (!secondaries.empty())
+            vkCmdExecuteCommands(command_buffer_set[frame_index], static_cast<uint32_t>(secondaries.size()), secondaries.data());
+        vkCmdEndRenderPass(command_buffer_set[frame_index]);
     }
+
+    command_buffer_set.end();
 }
 
 void VulkanInstance::mainLoop()
 {
-    createCommandBuffers();
-
     size_t currentFrame = 0;
     while (!glfwWindowShouldClose(window))
     {
         glfwPollEvents();
 
+        // hand finished transfers to the graphics queue and retire completed uploads
+        device_manager.upload_queue.poll(device_manager);
+
         // image synchronisation
         uint32_t image_index;
         {
@@ -267,7 +312,7 @@ void VulkanInstance::mainLoop()
             if (result == VK_ERROR_OUT_OF_DATE_KHR)
             {
                 recreateSwapChain();
-                return;
+                continue;
             }
             else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR)
                 log_error("failed to acquire swap chain image!");
@@ -278,10 +323,12 @@ void VulkanInstance::mainLoop()
             image_to_frame_fences[image_index] = frame_finished_fences[currentFrame];
         }
 
-        // update uniform buffer
-        update_uniforms_callback(image_index, device_manager.logicalDevice);
+        // everything owned by this frame (uniform slice, command buffers, descriptor sets) is free to reuse now
+        descriptor_pool.beginFrame(currentFrame);
+        update_uniforms_callback(currentFrame, device_manager.logicalDevice);
 
-        auto command_buffer = render_frame_callback(currentFrame);
+        recordCommandBuffer(currentFrame, image_index);
+        auto command_buffer = render_frame_callback(currentFrame, image_index);
 
         // submit command buffer
         {
@@ -294,7 +341,7 @@ void VulkanInstance::mainLoop()
             submitInfo.pWaitSemaphores = waitSemaphores;
             submitInfo.pWaitDstStageMask = waitStages;
 
-            std::array<VkCommandBuffer, 2> command_buffers = { command_buffer_set[image_index], command_buffer };
+            std::array<VkCommandBuffer, 2> command_buffers = { command_buffer_set[currentFrame], command_buffer };
 
             submitInfo.commandBufferCount = 2;
             submitInfo.pCommandBuffers = command_buffers.data();
@@ -332,10 +379,8 @@ void VulkanInstance::mainLoop()
             }
             else if (result != VK_SUCCESS)
                 log_error("failed to present swap chain image!");
-
-            vkQueueWaitIdle(device_manager.presentQueue);
         }
-        currentFrame = (currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+        currentFrame = (currentFrame + 1) % frames_in_flight;
     }
 
     vkDeviceWaitIdle(device_manager.logicalDevice);
@@ -353,8 +398,6 @@ void VulkanInstance::recreateSwapChain()
 
     vkDeviceWaitIdle(device_manager.logicalDevice);
 
-    command_buffer_set.deinit(device_manager);
-
     pipeline.deinit(device_manager, true);
     swapchain.deinit(device_manager);
 
@@ -366,7 +409,8 @@ void VulkanInstance::recreateSwapChain()
     swapchain.init(device_manager, window, surface);
     pipeline.reinit(device_manager, swapchain);
 
-    createCommandBuffers();
+    // the image count can change with the swapchain, nothing is in flight after the wait above
+    image_to_frame_fences.assign(swapchain.images.size(), VK_NULL_HANDLE);
 
     swapchain_recreate_callback();
 }
\ No newline at end of file
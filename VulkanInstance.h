@@ -10,6 +10,7 @@
 #include "VulkanWrapper/Swapchain.h"
 #include "VulkanWrapper/DeviceManager.h"
 #include "VulkanWrapper/Pipeline.h"
+#include "ThreadPool.h"
 
 #include <vector>
 #include <functional>
@@ -31,27 +32,39 @@ struct VulkanInstance
     Pipeline pipeline;
     DescriptorPool descriptor_pool;
 
-    CommandBufferSet command_buffer_set;
+    uint32_t frames_in_flight = 2; // set before init()
+
+    CommandBufferSet command_buffer_set; // Per frame in flight: scene commands, re-recorded every frame
+    SecondaryCommandBufferPool secondary_command_buffers;
+    ThreadPool thread_pool;
 
     std::vector<VkSemaphore> image_available_semaphores; // Per frame in flight: swap chain image is available to start being used
     std::vector<VkSemaphore> render_finished_semaphores; // Per frame in flight: signalled when command buffers have finished execution
     std::vector<VkFence> frame_finished_fences; // Per frame in flight
     std::vector<VkFence> image_to_frame_fences; // Per swapchain image
 
-    std::function<void(const VulkanWrapper::Pipeline& pipeline, const size_t i, const VkCommandBuffer command_buffer )> command_buffer_callback;
-    std::function<void(size_t image_index, VkDevice logical_device)> update_uniforms_callback;
+    std::function<void(const VulkanWrapper::Pipeline& pipeline, const size_t frame_index, const VkCommandBuffer command_buffer )> command_buffer_callback;
+
+    // Multithreaded alternative to command_buffer_callback: when set, the frame's draws are split into chunks of
+    // draws_per_task which are recorded in parallel into secondary command buffers. draw_range_callback runs on
+    // worker threads, so it must only read shared scene state.
+    std::function<size_t(const size_t frame_index)> draw_count_callback;
+    std::function<void(const VulkanWrapper::Pipeline& pipeline, const size_t frame_index, size_t first_draw, size_t draw_count, const VkCommandBuffer command_buffer)> draw_range_callback;
+    size_t draws_per_task = 512;
+    std::function<void(size_t frame_index, VkDevice logical_device)> update_uniforms_callback;
+    // optional, records work such as compute pre-passes into the frame's command buffer ahead of the render pass
+    std::function<void(size_t frame_index, VkCommandBuffer command_buffer)> pre_pass_callback;
 
     std::function<void()> swapchain_recreate_callback;
-    std::function<VkCommandBuffer(size_t)> render_frame_callback;
+    std::function<VkCommandBuffer(size_t frame_index, uint32_t image_index)> render_frame_callback;
 
     void init();
     void deinit();
 
-    void createCommandBuffers();
-
     void mainLoop();
 
 private:
+    void recordCommandBuffer(size_t frame_index, uint32_t image_index);
     void recreateSwapChain();
 };
 
@@ -13,34 +13,16 @@ namespace VulkanWrapper
 
     struct Buffer
     {
-        VkBuffer handle;
-        VkDeviceMemory memory;
+        VkBuffer handle = VK_NULL_HANDLE;
+        MemoryAllocation allocation;
         VkDeviceSize size_bytes;
         size_t count;
 
-        void init(VkPhysicalDevice physical_device, VkDevice logical_device, const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties);
-        void deinit(VkDevice logical_device);
+        void init(DeviceManager& device_manager, const VkDeviceSize size, const VkBufferUsageFlags usage, const VkMemoryPropertyFlags properties);
+        void deinit(DeviceManager& device_manager);
     };
 
-    void copyBuffer(DeviceManager& device_manager, Buffer& src_buffer, Buffer& dst_buffer);
-    void uploadData(Buffer& buffer, VkDevice logical_device, const void* data);
+    void uploadData(Buffer& buffer, const void* data);
 
-    void copyBufferToImage(const DeviceManager& device_manager, Buffer& buffer, Image& image);
-
-    template<typename T>
-    void uploadBufferData(DeviceManager& device_manager, Buffer& buffer, const std::vector<T>& data, VkBufferUsageFlagBits usage)
-    {
-        const VkDeviceSize bufferSize = sizeof(data[0]) * data.size();
-
-        Buffer stagingBuffer;
-        stagingBuffer.init(device_manager.physicalDevice, device_manager.logicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        uploadData(stagingBuffer, device_manager.logicalDevice, data.data());
-
-        buffer.init(device_manager.physicalDevice, device_manager.logicalDevice, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        buffer.count = data.size();
-
-        copyBuffer(device_manager, stagingBuffer, buffer);
-
-        stagingBuffer.deinit(device_manager.logicalDevice);
-    }
+    void copyBufferToImage(VkCommandBuffer command_buffer, VkBuffer buffer, VkDeviceSize buffer_offset, Image& image, uint32_t mip_level = 0);
 }
\ No newline at end of file
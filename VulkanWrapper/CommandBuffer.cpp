@@ -50,6 +50,77 @@ namespace VulkanWrapper
         active_buffer.reset();
     }
 
+    void SecondaryCommandBufferPool::init(const DeviceManager& device_manager, uint32_t frames_in_flight, uint32_t thread_count)
+    {
+        this->thread_count = thread_count;
+        pools.resize(frames_in_flight * thread_count);
+
+        VkCommandPoolCreateInfo poolInfo{};
+        poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        poolInfo.queueFamilyIndex = device_manager.graphicsQueueFamily;
+        poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        for (auto& pool : pools)
+        {
+            if (vkCreateCommandPool(device_manager.logicalDevice, &poolInfo, nullptr, &pool.handle) != VK_SUCCESS)
+                log_error("failed to create secondary command pool!");
+        }
+    }
+
+    void SecondaryCommandBufferPool::deinit(const DeviceManager& device_manager)
+    {
+        // destroying the pool frees its command buffers
+        for (auto& pool : pools)
+            vkDestroyCommandPool(device_manager.logicalDevice, pool.handle, nullptr);
+
+        pools.clear();
+    }
+
+    void SecondaryCommandBufferPool::reset(const DeviceManager& device_manager, size_t frame_index)
+    {
+        for (uint32_t i = 0; i < thread_count; ++i)
+        {
+            auto& pool = pools[frame_index * thread_count + i];
+            if (pool.used == 0)
+                continue;
+
+            vkResetCommandPool(device_manager.logicalDevice, pool.handle, 0);
+            pool.used = 0;
+        }
+    }
+
+    VkCommandBuffer SecondaryCommandBufferPool::begin(const DeviceManager& device_manager, size_t frame_index, uint32_t thread_index, const VkCommandBufferInheritanceInfo& inheritance)
+    {
+        auto& pool = pools[frame_index * thread_count + thread_index];
+
+        if (pool.used == pool.buffers.size())
+        {
+            VkCommandBufferAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            allocInfo.commandPool = pool.handle;
+            allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            allocInfo.commandBufferCount = 1;
+
+            VkCommandBuffer command_buffer;
+            if (vkAllocateCommandBuffers(device_manager.logicalDevice, &allocInfo, &command_buffer) != VK_SUCCESS)
+                log_error("failed to allocate secondary command buffer!");
+
+            pool.buffers.push_back(command_buffer);
+        }
+
+        VkCommandBuffer command_buffer = pool.buffers[pool.used++];
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+        beginInfo.pInheritanceInfo = &inheritance;
+
+        if (vkBeginCommandBuffer(command_buffer, &beginInfo) != VK_SUCCESS)
+            log_error("failed to begin recording secondary command buffer!");
+
+        return command_buffer;
+    }
+
     void SingleTimeCommandBuffer::begin(const DeviceManager& device_manager)
     {
         command_buffer_set.init(device_manager, 1);
@@ -25,6 +25,30 @@ namespace VulkanWrapper
         void end();
     };
 
+    // Secondary command buffers for recording inside a render pass from several threads.
+    // Every (frame in flight, thread) pair has its own command pool, so threads never share a pool
+    // and a frame's buffers are recycled with one pool reset once its fence has signalled.
+    struct SecondaryCommandBufferPool
+    {
+        struct Pool
+        {
+            VkCommandPool handle;
+            std::vector<VkCommandBuffer> buffers;
+            size_t used = 0;
+        };
+
+        std::vector<Pool> pools; // indexed by frame_index * thread_count + thread_index
+        uint32_t thread_count = 0;
+
+        void init(const DeviceManager& device_manager, uint32_t frames_in_flight, uint32_t thread_count);
+        void deinit(const DeviceManager& device_manager);
+
+        void reset(const DeviceManager& device_manager, size_t frame_index);
+
+        // returns a command buffer in the recording state, the caller ends it with vkEndCommandBuffer
+        VkCommandBuffer begin(const DeviceManager& device_manager, size_t frame_index, uint32_t thread_index, const VkCommandBufferInheritanceInfo& inheritance);
+    };
+
     struct SingleTimeCommandBuffer
     {
         CommandBufferSet command_buffer_set;
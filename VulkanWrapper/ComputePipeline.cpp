@@ -0,0 +1,68 @@
+#include "ComputePipeline.h"
+
+#include "Log.h"
+
+#include <vector>
+
+namespace VulkanWrapper
+{
+    void ComputePipeline::init(DeviceManager& device_manager, const ComputeShaderSettings& shader_settings)
+    {
+        this->shader_settings = shader_settings;
+
+        std::vector<VkDescriptorSetLayout> layouts(shader_settings.descriptor_set_layouts.size());
+        for (size_t i = 0; i < shader_settings.descriptor_set_layouts.size(); i++)
+            layouts[i] = shader_settings.descriptor_set_layouts[i].handle;
+
+        VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+        pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(layouts.size());
+        pipelineLayoutInfo.pSetLayouts = layouts.data();
+        pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(shader_settings.push_constant_ranges.size());
+        pipelineLayoutInfo.pPushConstantRanges = shader_settings.push_constant_ranges.data();
+
+        if (vkCreatePipelineLayout(device_manager.logicalDevice, &pipelineLayoutInfo, nullptr, &pipeline_layout) != VK_SUCCESS)
+            log_error("failed to create compute pipeline layout!");
+
+        Shader comp_shader;
+        comp_shader.init(shader_settings.comp_addr, Shader::Type::Compute, device_manager.logicalDevice);
+
+        std::vector<VkSpecializationMapEntry> specialization_entries(shader_settings.specialization_constants.size());
+        for (uint32_t i = 0; i < specialization_entries.size(); i++)
+        {
+            specialization_entries[i].constantID = i;
+            specialization_entries[i].offset = i * sizeof(uint32_t);
+            specialization_entries[i].size = sizeof(uint32_t);
+        }
+
+        VkSpecializationInfo specializationInfo{};
+        specializationInfo.mapEntryCount = static_cast<uint32_t>(specialization_entries.size());
+        specializationInfo.pMapEntries = specialization_entries.data();
+        specializationInfo.dataSize = shader_settings.specialization_constants.size() * sizeof(uint32_t);
+        specializationInfo.pData = shader_settings.specialization_constants.data();
+
+        VkComputePipelineCreateInfo pipelineInfo{};
+        pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipelineInfo.stage = comp_shader.create_info;
+        if (!specialization_entries.empty())
+            pipelineInfo.stage.pSpecializationInfo = &specializationInfo;
+        pipelineInfo.layout = pipeline_layout;
+        pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+
+        if (vkCreateComputePipelines(device_manager.logicalDevice, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline) != VK_SUCCESS)
+            log_error("failed to create compute pipeline!");
+
+        comp_shader.deinit(device_manager.logicalDevice);
+    }
+
+    void ComputePipeline::deinit(DeviceManager& device_manager)
+    {
+        vkDestroyPipeline(device_manager.logicalDevice, pipeline, nullptr);
+        vkDestroyPipelineLayout(device_manager.logicalDevice, pipeline_layout, nullptr);
+    }
+
+    void ComputePipeline::dispatch(VkCommandBuffer command_buffer, uint32_t invocations, uint32_t workgroup_size) const
+    {
+        vkCmdDispatch(command_buffer, (invocations + workgroup_size - 1) / workgroup_size, 1, 1);
+    }
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "VulkanWrapper/DeviceManager.h"
+#include "VulkanWrapper/Shader.h"
+
+namespace VulkanWrapper
+{
+    // A compute shader and its layout, the counterpart to Pipeline for work recorded outside the render pass.
+    // The descriptor set layouts must have been uploaded already and outlive the pipeline
+    struct ComputePipeline
+    {
+        VkPipeline pipeline;
+        VkPipelineLayout pipeline_layout;
+
+        ComputeShaderSettings shader_settings;
+
+        void init(DeviceManager& device_manager, const ComputeShaderSettings& shader_settings);
+        void deinit(DeviceManager& device_manager);
+
+        // invocations are rounded up to whole workgroups of workgroup_size
+        void dispatch(VkCommandBuffer command_buffer, uint32_t invocations, uint32_t workgroup_size) const;
+    };
+}
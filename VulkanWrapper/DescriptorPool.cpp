@@ -3,134 +3,299 @@
 #include "Image.h"
 #include "Log.h"
 
+#include <algorithm>
 #include <array>
+#include <iterator>
 
 namespace VulkanWrapper
 {
-	void DescriptorPool::init(VkDevice logical_device, const uint32_t swapchain_count, const std::vector<DescriptorSetLayout>& descriptor_set_layouts)
+	namespace
 	{
-        uint32_t uniform_buffer_count = 0;
-        uint32_t sampler_count = 0;
-        uint32_t set_count = 0;
-        for (const auto& layout : descriptor_set_layouts) 
+		struct PoolRatio
+		{
+			VkDescriptorType type;
+			uint32_t per_set;
+		};
+
+		// rough descriptors per set of each type, a pool is never smaller than the set that caused it to be created
+		constexpr PoolRatio pool_ratios[] = {
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 2 },
+			{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+			{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 },
+			{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4 },
+		};
+
+		constexpr uint64_t handleBits(uint64_t handle) { return handle; }
+		template<typename T> uint64_t handleBits(T* handle) { return reinterpret_cast<uint64_t>(handle); }
+	}
+
+	void DescriptorPool::init(VkDevice logical_device, const uint32_t frames_in_flight)
+	{
+        this->logical_device = logical_device;
+        frame_pools.resize(frames_in_flight);
+	}
+
+    void DescriptorPool::deinit(VkDevice logical_device)
+    {
+        auto destroyChain = [&](PoolChain& chain)
         {
-            uint32_t multiplier = layout.update_per_frame ? swapchain_count : 1;
+            for (VkDescriptorPool pool : chain.pools)
+                vkDestroyDescriptorPool(logical_device, pool, nullptr);
+            chain = {};
+        };
 
-            for (const auto& binding : layout.bindings) 
+        destroyChain(persistent);
+        destroyChain(persistent_update_after_bind);
+        for (auto& chain : frame_pools)
+            destroyChain(chain);
+        frame_pools.clear();
+        cached_sets.clear();
+    }
+
+    void DescriptorPool::beginFrame(uint32_t frame_index)
+    {
+        if (frame_index >= frame_pools.size())
+            return;
+
+        // the pools stay around, so a frame that needs as many sets as the last one doesn't create any
+        PoolChain& chain = frame_pools[frame_index];
+        for (VkDescriptorPool pool : chain.pools)
+            vkResetDescriptorPool(logical_device, pool, 0);
+        chain.current = 0;
+    }
+
+    VkDescriptorPool DescriptorPool::createPool(const DescriptorSetLayout& layout, VkDescriptorPoolCreateFlags flags, uint32_t set_count) const
+    {
+        std::array<VkDescriptorPoolSize, std::size(pool_ratios)> pool_sizes{};
+        for (size_t i = 0; i < pool_sizes.size(); ++i)
+        {
+            uint32_t layout_count = 0;
+            for (const auto& binding : layout.bindings)
             {
-                if (binding.descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
-                {
-                    uniform_buffer_count += multiplier * layout.count;
-                }
-                else if (binding.descriptor_type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
-                {
-                    sampler_count += multiplier * layout.count;
-                }
-                else
-                {
-                    log_error("Unhandled descriptor type!");
-                }
+                if (binding.descriptor_type == pool_ratios[i].type)
+                    layout_count += binding.descriptor_count;
             }
-        }
-        set_count = uniform_buffer_count + sampler_count;
 
-        std::array<VkDescriptorPoolSize, 2> poolSizes{};
-        uint32_t i = 0;
-        if (uniform_buffer_count > 0)
-        {
-            poolSizes[i].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            poolSizes[i].descriptorCount = uniform_buffer_count;
-            ++i;
+            pool_sizes[i].type = pool_ratios[i].type;
+            pool_sizes[i].descriptorCount = std::max(pool_ratios[i].per_set * sets_per_pool, layout_count * set_count);
         }
-        if (sampler_count > 0)
+
+        for (const auto& binding : layout.bindings)
         {
-            poolSizes[i].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-            poolSizes[i].descriptorCount = sampler_count;
-            ++i;
+            if (std::none_of(std::begin(pool_ratios), std::end(pool_ratios), [&](const PoolRatio& ratio) { return ratio.type == binding.descriptor_type; }))
+                log_error("Unhandled descriptor type!");
         }
 
         VkDescriptorPoolCreateInfo poolInfo{};
         poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolInfo.poolSizeCount = i;
-        poolInfo.pPoolSizes = poolSizes.data();
-        poolInfo.maxSets = set_count;
+        poolInfo.flags = flags;
+        poolInfo.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+        poolInfo.pPoolSizes = pool_sizes.data();
+        poolInfo.maxSets = std::max(sets_per_pool, set_count);
 
-        if (vkCreateDescriptorPool(logical_device, &poolInfo, nullptr, &handle) != VK_SUCCESS)
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(logical_device, &poolInfo, nullptr, &pool) != VK_SUCCESS)
             log_error("failed to create descriptor pool");
-	}
+        return pool;
+    }
 
-    VkDescriptorSet DescriptorPool::createDescriptorSet(VkDevice logical_device, const DescriptorSetLayout& layout, const std::vector<Buffer*>& uniform_buffers, const std::vector<Texture*>& textures)
+    void DescriptorPool::allocateFrom(PoolChain& chain, const DescriptorSetLayout& layout, VkDescriptorPoolCreateFlags flags, uint32_t count, VkDescriptorSet* descriptor_sets)
     {
+        // vkAllocateDescriptorSets takes a layout per set
+        VkDescriptorSetLayout set_layouts[max_batch_size];
+        std::fill(std::begin(set_layouts), std::end(set_layouts), layout.handle);
+
         VkDescriptorSetAllocateInfo allocInfo{};
         allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-        allocInfo.descriptorPool = handle;
-        allocInfo.descriptorSetCount = 1;
-        allocInfo.pSetLayouts = &layout.handle;
+        allocInfo.pSetLayouts = set_layouts;
+
+        while (count > 0)
+        {
+            allocInfo.descriptorSetCount = std::min(count, max_batch_size);
+
+            // a full pool is only moved past, after a reset it is the first one tried again
+            bool allocated = false;
+            for (; chain.current < chain.pools.size(); ++chain.current)
+            {
+                allocInfo.descriptorPool = chain.pools[chain.current];
+                const VkResult result = vkAllocateDescriptorSets(logical_device, &allocInfo, descriptor_sets);
+                if (result == VK_SUCCESS)
+                {
+                    allocated = true;
+                    break;
+                }
+                if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL)
+                    log_error("failed to allocate descriptor sets!");
+            }
+
+            if (!allocated)
+            {
+                chain.pools.push_back(createPool(layout, flags, allocInfo.descriptorSetCount));
+                chain.current = chain.pools.size() - 1;
+
+                allocInfo.descriptorPool = chain.pools.back();
+                if (vkAllocateDescriptorSets(logical_device, &allocInfo, descriptor_sets) != VK_SUCCESS)
+                    log_error("failed to allocate descriptor sets!");
+            }
+
+            descriptor_sets += allocInfo.descriptorSetCount;
+            count -= allocInfo.descriptorSetCount;
+        }
+    }
+
+    void DescriptorPool::allocate(const DescriptorSetLayout& layout, uint32_t count, VkDescriptorSet* descriptor_sets)
+    {
+        if (layout.updateAfterBind())
+            allocateFrom(persistent_update_after_bind, layout, VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT, count, descriptor_sets);
+        else
+            allocateFrom(persistent, layout, 0, count, descriptor_sets);
+    }
+
+    void DescriptorPool::allocateTransient(uint32_t frame_index, const DescriptorSetLayout& layout, uint32_t count, VkDescriptorSet* descriptor_sets)
+    {
+        // update after bind sets are long lived tables, nothing rewrites a set that only lasts a frame while it is bound
+        if (layout.updateAfterBind())
+            log_error("update after bind descriptor sets can't be transient");
+
+        allocateFrom(frame_pools[frame_index], layout, 0, count, descriptor_sets);
+    }
+
+    void DescriptorPool::createDescriptorSets(const DescriptorSetLayout& layout, uint32_t count, const DescriptorData* data, VkDescriptorSet* descriptor_sets)
+    {
+        allocate(layout, count, descriptor_sets);
+        for (uint32_t i = 0; i < count; ++i)
+            layout.write(logical_device, descriptor_sets[i], data + i * layout.written_binding_count);
+    }
+
+    void DescriptorPool::createTransientDescriptorSets(uint32_t frame_index, const DescriptorSetLayout& layout, uint32_t count, const DescriptorData* data, VkDescriptorSet* descriptor_sets)
+    {
+        allocateTransient(frame_index, layout, count, descriptor_sets);
+        for (uint32_t i = 0; i < count; ++i)
+            layout.write(logical_device, descriptor_sets[i], data + i * layout.written_binding_count);
+    }
+
+    VkDescriptorSet DescriptorPool::createDescriptorSet(const DescriptorSetLayout& layout, const std::vector<Buffer*>& uniform_buffers, const std::vector<Texture*>& textures)
+    {
+        DescriptorData data[DescriptorSetLayout::max_bindings];
+        fillDescriptorData(layout, uniform_buffers, textures, data);
 
         VkDescriptorSet descriptor_set;
-        if (vkAllocateDescriptorSets(logical_device, &allocInfo, &descriptor_set) != VK_SUCCESS)
-            log_error("failed to allocate descriptor sets!");
+        createDescriptorSets(layout, 1, data, &descriptor_set);
+        return descriptor_set;
+    }
 
-        std::vector<VkDescriptorBufferInfo> buffer_infos(layout.bindings.size());
-        std::vector<VkDescriptorImageInfo> image_infos(layout.bindings.size());
-        std::vector<VkWriteDescriptorSet> descriptor_writes(layout.bindings.size());
+    VkDescriptorSet DescriptorPool::createTransientDescriptorSet(uint32_t frame_index, const DescriptorSetLayout& layout, const std::vector<Buffer*>& uniform_buffers, const std::vector<Texture*>& textures)
+    {
+        DescriptorData data[DescriptorSetLayout::max_bindings];
+        fillDescriptorData(layout, uniform_buffers, textures, data);
 
+        VkDescriptorSet descriptor_set;
+        createTransientDescriptorSets(frame_index, layout, 1, data, &descriptor_set);
+        return descriptor_set;
+    }
+
+    size_t DescriptorPool::CachedSetKeyHash::operator()(const CachedSetKey& key) const
+    {
+        size_t hash = 14695981039346656037ull;
+        auto mix = [&](uint64_t value)
+        {
+            for (int i = 0; i < 8; ++i)
+                hash = (hash ^ ((value >> (i * 8)) & 0xFF)) * 1099511628211ull;
+        };
+
+        mix(handleBits(key.layout));
+        for (uint64_t handle : key.contents)
+            mix(handle);
+        return hash;
+    }
+
+    VkDescriptorSet DescriptorPool::getCachedDescriptorSet(const DescriptorSetLayout& layout, const std::vector<Buffer*>& uniform_buffers, const std::vector<Texture*>& textures)
+    {
+        // buffer offsets and ranges follow from the layout, so the handles are all that can differ
+        CachedSetKey key{ layout.handle, {} };
+        key.contents.reserve(uniform_buffers.size() + textures.size() * 2);
+        for (const Buffer* buffer : uniform_buffers)
+            key.contents.push_back(handleBits(buffer->handle));
+        for (const Texture* texture : textures)
+        {
+            key.contents.push_back(handleBits(texture->image.view));
+            key.contents.push_back(handleBits(texture->sampler));
+        }
+
+        auto found = cached_sets.find(key);
+        if (found != cached_sets.end())
+            return found->second;
+
+        const VkDescriptorSet descriptor_set = createDescriptorSet(layout, uniform_buffers, textures);
+        cached_sets.emplace(std::move(key), descriptor_set);
+        return descriptor_set;
+    }
+
+    void fillDescriptorData(const DescriptorSetLayout& layout, const std::vector<Buffer*>& uniform_buffers, const std::vector<Texture*>& textures, DescriptorData* data)
+    {
         VkDeviceSize current_offset = 0;
-        uint32_t current_binding = 0;
 
         int current_uniform_index = 0;
         int current_texture_index = 0;
 
-        for (uint32_t current_binding = 0; current_binding < layout.bindings.size(); current_binding++)
+        for (const auto& binding : layout.bindings)
         {
-            auto& binding = layout.bindings[current_binding];
+            // descriptor arrays are partially bound and filled in by their owner, e.g. the TextureTable
+            if (binding.descriptor_count > 1)
+                continue;
 
-            auto& descriptor_write = descriptor_writes[current_binding];
-            descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            descriptor_write.dstSet = descriptor_set;
-            descriptor_write.dstBinding = current_binding;
-            descriptor_write.dstArrayElement = 0;
-            descriptor_write.descriptorType = binding.descriptor_type;
-            descriptor_write.descriptorCount = 1;
+            DescriptorData& descriptor = *data++;
 
-            if (binding.descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER)
+            if (binding.descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER || binding.descriptor_type == VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC)
             {
-                auto& buffer_info = buffer_infos[current_binding];
-
-                buffer_info.buffer = uniform_buffers[current_uniform_index]->handle;
-                buffer_info.offset = current_offset;
-                buffer_info.range = binding.uniform_data_size;
+                // for dynamic uniform buffers this is the base that the dynamic offset is added to
+                descriptor.buffer.buffer = uniform_buffers[current_uniform_index]->handle;
+                descriptor.buffer.offset = current_offset;
+                descriptor.buffer.range = binding.uniform_data_size;
                 current_offset += binding.uniform_data_size;
 
-                descriptor_write.pBufferInfo = &buffer_info;
+                ++current_uniform_index;
+            }
+            else if (binding.descriptor_type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER)
+            {
+                // storage buffers are runtime sized arrays, so always the whole buffer
+                descriptor.buffer.buffer = uniform_buffers[current_uniform_index]->handle;
+                descriptor.buffer.offset = 0;
+                descriptor.buffer.range = VK_WHOLE_SIZE;
 
                 ++current_uniform_index;
             }
             else if (binding.descriptor_type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
             {
-                auto& image_info = image_infos[current_binding];
-
                 Texture* tex = textures[current_texture_index];
 
-                image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-                image_info.imageView = tex->image.view;
-                image_info.sampler = tex->sampler;
-
-                descriptor_write.pImageInfo = &image_info;
+                descriptor.image.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+                descriptor.image.imageView = tex->image.view;
+                descriptor.image.sampler = tex->sampler;
 
                 ++current_texture_index;
             }
             else
                 log_error("Unsupported uniform binding type");
-
         }
-        vkUpdateDescriptorSets(logical_device, static_cast<uint32_t>(descriptor_writes.size()), descriptor_writes.data(), 0, nullptr);
-
-        return descriptor_set;
     }
 
-    void DescriptorPool::deinit(VkDevice logical_device)
+    void updateTextureDescriptor(VkDevice logical_device, VkDescriptorSet descriptor_set, uint32_t binding, const Texture& texture, uint32_t array_element)
     {
-        vkDestroyDescriptorPool(logical_device, handle, nullptr);
+        VkDescriptorImageInfo image_info{};
+        image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        image_info.imageView = texture.image.view;
+        image_info.sampler = texture.sampler;
+
+        VkWriteDescriptorSet descriptor_write{};
+        descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptor_write.dstSet = descriptor_set;
+        descriptor_write.dstBinding = binding;
+        descriptor_write.dstArrayElement = array_element;
+        descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptor_write.descriptorCount = 1;
+        descriptor_write.pImageInfo = &image_info;
+
+        vkUpdateDescriptorSets(logical_device, 1, &descriptor_write, 0, nullptr);
     }
 }
\ No newline at end of file
@@ -6,19 +6,79 @@
 #include "VulkanWrapper/Buffer.h"
 #include "VulkanWrapper/Shader.h"
 
+#include <unordered_map>
 #include <vector>
 
 namespace VulkanWrapper
 {
 	struct Texture;
 
+	// Allocates descriptor sets from pools that are created as they are needed, so nothing has to be counted up front.
+	// Persistent sets live until deinit, transient sets only until their frame comes around again, when the frame's
+	// pools are reset in bulk. Sets whose contents never change can be shared through getCachedDescriptorSet.
 	struct DescriptorPool
 	{
-		VkDescriptorPool handle;
+		// a run of pools, allocated from in order and grown when the last one runs out
+		struct PoolChain
+		{
+			std::vector<VkDescriptorPool> pools;
+			size_t current = 0;
+		};
 
-		VkDescriptorSet createDescriptorSet(VkDevice logical_device, const DescriptorSetLayout& layout, const std::vector<Buffer*>& uniform_buffers, const std::vector<Texture*>& textures);
+		struct CachedSetKey
+		{
+			VkDescriptorSetLayout layout;
+			std::vector<uint64_t> contents; // buffer, image view and sampler handles in binding order
 
-		void init(VkDevice logical_device, const uint32_t swapchain_count, const std::vector<DescriptorSetLayout>& descriptor_set_layouts);
+			bool operator==(const CachedSetKey& other) const { return layout == other.layout && contents == other.contents; }
+		};
+
+		struct CachedSetKeyHash
+		{
+			size_t operator()(const CachedSetKey& key) const;
+		};
+
+		uint32_t sets_per_pool = 64;
+
+		VkDevice logical_device = VK_NULL_HANDLE;
+		PoolChain persistent;
+		PoolChain persistent_update_after_bind; // update after bind sets can only come from update after bind pools
+		std::vector<PoolChain> frame_pools; // per frame in flight
+		std::unordered_map<CachedSetKey, VkDescriptorSet, CachedSetKeyHash> cached_sets;
+
+		void init(VkDevice logical_device, const uint32_t frames_in_flight);
 		void deinit(VkDevice logical_device);
+
+		// frees every transient set of the frame, call once its fence has been waited on
+		void beginFrame(uint32_t frame_index);
+
+		void allocate(const DescriptorSetLayout& layout, uint32_t count, VkDescriptorSet* descriptor_sets);
+		void allocateTransient(uint32_t frame_index, const DescriptorSetLayout& layout, uint32_t count, VkDescriptorSet* descriptor_sets);
+
+		// allocates count sets and writes each from layout.written_binding_count entries of data, see DescriptorSetLayout::write.
+		// Sets live until deinit
+		void createDescriptorSets(const DescriptorSetLayout& layout, uint32_t count, const DescriptorData* data, VkDescriptorSet* descriptor_sets);
+		// as createDescriptorSets, but the sets are only valid for the current frame
+		void createTransientDescriptorSets(uint32_t frame_index, const DescriptorSetLayout& layout, uint32_t count, const DescriptorData* data, VkDescriptorSet* descriptor_sets);
+
+		// single set versions, written from the buffers and textures as fillDescriptorData does
+		VkDescriptorSet createDescriptorSet(const DescriptorSetLayout& layout, const std::vector<Buffer*>& uniform_buffers, const std::vector<Texture*>& textures);
+		VkDescriptorSet createTransientDescriptorSet(uint32_t frame_index, const DescriptorSetLayout& layout, const std::vector<Buffer*>& uniform_buffers, const std::vector<Texture*>& textures);
+		// one shared set per layout and contents, the set must never be written to afterwards
+		VkDescriptorSet getCachedDescriptorSet(const DescriptorSetLayout& layout, const std::vector<Buffer*>& uniform_buffers, const std::vector<Texture*>& textures);
+
+	private:
+		static constexpr uint32_t max_batch_size = 16; // sets per vkAllocateDescriptorSets call
+
+		VkDescriptorPool createPool(const DescriptorSetLayout& layout, VkDescriptorPoolCreateFlags flags, uint32_t set_count) const;
+		void allocateFrom(PoolChain& chain, const DescriptorSetLayout& layout, VkDescriptorPoolCreateFlags flags, uint32_t count, VkDescriptorSet* descriptor_sets);
 	};
+
+	// the data for every single descriptor binding, taking buffers and textures in binding order. Uniform buffers are
+	// laid out back to back from offset 0, storage buffers are bound whole
+	void fillDescriptorData(const DescriptorSetLayout& layout, const std::vector<Buffer*>& uniform_buffers, const std::vector<Texture*>& textures, DescriptorData* data);
+
+	// points a combined image sampler binding (or one element of it) at the texture's current image,
+	// the descriptor must not be in use by the GPU
+	void updateTextureDescriptor(VkDevice logical_device, VkDescriptorSet descriptor_set, uint32_t binding, const Texture& texture, uint32_t array_element = 0);
 }
\ No newline at end of file
@@ -13,6 +13,7 @@ namespace VulkanWrapper
     {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily;
 
         SwapChainSupport swapchain_support;
 
@@ -42,17 +43,31 @@ namespace VulkanWrapper
 
             for (int i = 0; i < queueFamilies.size(); ++i)
             {
-                if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT)
+                const VkQueueFlags flags = queueFamilies[i].queueFlags;
+
+                // compute pre-passes are recorded into the frame's graphics command buffer
+                if (!deviceSettings.graphicsFamily && (flags & VK_QUEUE_GRAPHICS_BIT) && (flags & VK_QUEUE_COMPUTE_BIT))
                     deviceSettings.graphicsFamily = i;
 
                 VkBool32 presentSupport{};
                 vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
-                if (presentSupport)
+                if (!deviceSettings.presentFamily && presentSupport)
                     deviceSettings.presentFamily = i;
 
-                if (!deviceSettings.graphicsFamily || !deviceSettings.presentFamily)
-                    return deviceSettings;
+                // prefer a transfer only family (the copy engine), then any non graphics family that can transfer
+                if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT))
+                {
+                    if (!(flags & VK_QUEUE_COMPUTE_BIT) || !deviceSettings.transferFamily)
+                        deviceSettings.transferFamily = i;
+                }
             }
+
+            if (!deviceSettings.graphicsFamily || !deviceSettings.presentFamily)
+                return deviceSettings;
+
+            // graphics queues always support transfers
+            if (!deviceSettings.transferFamily)
+                deviceSettings.transferFamily = deviceSettings.graphicsFamily;
         }
 
         {
@@ -71,6 +86,25 @@ namespace VulkanWrapper
                 return deviceSettings;
         }
 
+        {
+            // the bindless texture table needs descriptor indexing, which is core since 1.2
+            if (properties.apiVersion < VK_API_VERSION_1_2)
+                return deviceSettings;
+
+            VkPhysicalDeviceVulkan12Features vulkan12_features{};
+            vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+            VkPhysicalDeviceFeatures2 features2{};
+            features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+            features2.pNext = &vulkan12_features;
+            vkGetPhysicalDeviceFeatures2(device, &features2);
+
+            if (!vulkan12_features.runtimeDescriptorArray || !vulkan12_features.descriptorBindingPartiallyBound
+                || !vulkan12_features.descriptorBindingSampledImageUpdateAfterBind || !vulkan12_features.descriptorBindingUpdateUnusedWhilePending
+                || !vulkan12_features.shaderSampledImageArrayNonUniformIndexing)
+                return deviceSettings;
+        }
+
         {
             // check swapchain support
             deviceSettings.swapchain_support = getSwapchainSupport(device, surface);
@@ -128,6 +162,7 @@ namespace VulkanWrapper
                     physicalDevice = device;
                     graphicsQueueFamily = deviceSettings.graphicsFamily.value();
                     presentQueueFamily = deviceSettings.presentFamily.value();
+                    transferQueueFamily = deviceSettings.transferFamily.value();
 
                     surface_capabilities = deviceSettings.swapchain_support.capabilities;
                     surface_formats = deviceSettings.swapchain_support.formats;
@@ -166,7 +201,7 @@ namespace VulkanWrapper
         {
             // create logical device
             std::vector<VkDeviceQueueCreateInfo> queueCreateInfos{};
-            std::set<uint32_t> uniqueQueueFamilies = { graphicsQueueFamily, presentQueueFamily };
+            std::set<uint32_t> uniqueQueueFamilies = { graphicsQueueFamily, presentQueueFamily, transferQueueFamily };
 
             const float queuePriority = 1.0f;
             for (auto queueFamily : uniqueQueueFamilies)
@@ -179,15 +214,31 @@ namespace VulkanWrapper
                 queueCreateInfos.push_back(queueCreateInfo);
             }
 
-            VkPhysicalDeviceFeatures deviceFeatures{};
-            deviceFeatures.samplerAnisotropy = VK_TRUE;
-            deviceFeatures.sampleRateShading = VK_TRUE; // enable sample shading to stop alisaing within textures
+            VkPhysicalDeviceFeatures supported_features;
+            vkGetPhysicalDeviceFeatures(physicalDevice, &supported_features);
+
+            enabled_features = {};
+            enabled_features.samplerAnisotropy = VK_TRUE;
+            enabled_features.sampleRateShading = VK_TRUE; // enable sample shading to stop alisaing within textures
+            // block compressed textures are used when available, otherwise they are decompressed on load
+            enabled_features.textureCompressionBC = supported_features.textureCompressionBC;
+
+            // descriptor indexing for the bindless texture table, checked in isDeviceSuitable
+            enabled_vulkan12_features = {};
+            enabled_vulkan12_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+            enabled_vulkan12_features.descriptorIndexing = VK_TRUE;
+            enabled_vulkan12_features.runtimeDescriptorArray = VK_TRUE;
+            enabled_vulkan12_features.descriptorBindingPartiallyBound = VK_TRUE;
+            enabled_vulkan12_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+            enabled_vulkan12_features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+            enabled_vulkan12_features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
 
             VkDeviceCreateInfo createInfo{};
             createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
             createInfo.pQueueCreateInfos = queueCreateInfos.data();
             createInfo.queueCreateInfoCount = (uint32_t)queueCreateInfos.size();
-            createInfo.pEnabledFeatures = &deviceFeatures;
+            createInfo.pEnabledFeatures = &enabled_features;
+            createInfo.pNext = &enabled_vulkan12_features;
 
             createInfo.enabledExtensionCount = (uint32_t)device_extensions.size();
             createInfo.ppEnabledExtensionNames = device_extensions.data();
@@ -209,6 +260,7 @@ namespace VulkanWrapper
 
             vkGetDeviceQueue(logicalDevice, graphicsQueueFamily, 0, &graphicsQueue);
             vkGetDeviceQueue(logicalDevice, presentQueueFamily, 0, &presentQueue);
+            vkGetDeviceQueue(logicalDevice, transferQueueFamily, 0, &transferQueue);
         }
 
         // create command pool
@@ -220,11 +272,27 @@ namespace VulkanWrapper
 
             if (vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &command_pool) != VK_SUCCESS)
                 log_error("failed to create command pool!");
+
+            // upload command buffers are short lived, so the transfer pool hands them out transient
+            poolInfo.queueFamilyIndex = transferQueueFamily;
+            poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+            if (vkCreateCommandPool(logicalDevice, &poolInfo, nullptr, &transfer_command_pool) != VK_SUCCESS)
+                log_error("failed to create transfer command pool!");
         }
+
+        allocator.init(physicalDevice, logicalDevice);
+        sampler_cache.init(physicalDevice, logicalDevice);
     }
 
     void DeviceManager::deinit()
     {
+        upload_queue.deinit(*this);
+        staging_arena.deinit(logicalDevice, allocator);
+        allocator.deinit();
+        sampler_cache.deinit();
+
+        vkDestroyCommandPool(logicalDevice, transfer_command_pool, nullptr);
         vkDestroyCommandPool(logicalDevice, command_pool, nullptr);
 
         vkDestroyDevice(logicalDevice, nullptr);
@@ -3,6 +3,11 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "MemoryAllocator.h"
+#include "StagingArena.h"
+#include "UploadQueue.h"
+#include "SamplerCache.h"
+
 #include <vector>
 
 namespace VulkanWrapper
@@ -16,12 +21,22 @@ namespace VulkanWrapper
         VkPhysicalDevice physicalDevice = VK_NULL_HANDLE;
         uint32_t graphicsQueueFamily;
         uint32_t presentQueueFamily;
+        uint32_t transferQueueFamily; // same as graphicsQueueFamily when there is no dedicated transfer family
         VkQueue graphicsQueue;
         VkQueue presentQueue;
+        VkQueue transferQueue;
 
         VkCommandPool command_pool;
+        VkCommandPool transfer_command_pool;
 
         VkDevice logicalDevice;
+        VkPhysicalDeviceFeatures enabled_features;
+        VkPhysicalDeviceVulkan12Features enabled_vulkan12_features;
+
+        MemoryAllocator allocator;
+        StagingArena staging_arena;
+        UploadQueue upload_queue;
+        SamplerCache sampler_cache;
 
         VkSurfaceCapabilitiesKHR surface_capabilities;
         std::vector<VkSurfaceFormatKHR> surface_formats;
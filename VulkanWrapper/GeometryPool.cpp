@@ -0,0 +1,134 @@
+#include "GeometryPool.h"
+#include "UploadBatch.h"
+#include "Log.h"
+
+#include <algorithm>
+
+namespace VulkanWrapper
+{
+    static VkDeviceSize indexSize(const VkIndexType index_type)
+    {
+        return index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+    void GeometryPool::init(const VkDeviceSize vertex_stride, const VkDeviceSize skin_stride, const uint32_t page_vertex_capacity, const uint32_t page_index_capacity)
+    {
+        if (skin_stride > vertex_stride)
+            log_error("skin stream can't be wider than the vertices");
+
+        this->vertex_stride = vertex_stride;
+        this->skin_stride = skin_stride;
+        this->page_vertex_capacity = page_vertex_capacity;
+        this->page_index_capacity = page_index_capacity;
+    }
+
+    void GeometryPool::deinit(DeviceManager& device_manager)
+    {
+        for (auto& page : pages)
+        {
+            page.vertex_buffer.deinit(device_manager);
+            if (page.skin_buffer.handle != VK_NULL_HANDLE)
+                page.skin_buffer.deinit(device_manager);
+            if (page.index16_buffer.handle != VK_NULL_HANDLE)
+                page.index16_buffer.deinit(device_manager);
+            if (page.index32_buffer.handle != VK_NULL_HANDLE)
+                page.index32_buffer.deinit(device_manager);
+        }
+
+        pages.clear();
+    }
+
+    uint32_t GeometryPool::findPage(DeviceManager& device_manager, const uint32_t vertex_count, const uint32_t index_count, const VkIndexType index_type)
+    {
+        for (uint32_t i = 0; i < pages.size(); ++i)
+        {
+            const auto& page = pages[i];
+            // index buffers that don't exist yet are created with the page's capacity
+            const uint32_t used_indices = index_type == VK_INDEX_TYPE_UINT16 ? page.index16_count : page.index32_count;
+            const bool indices_fit = used_indices + index_count <= page.index_capacity;
+
+            if (page.vertex_count + vertex_count <= page.vertex_buffer.count && indices_fit)
+                return i;
+        }
+
+        // meshes bigger than a page get a page of their own, index buffers are only created for the index types used
+        const uint32_t vertex_capacity = std::max(page_vertex_capacity, vertex_count);
+
+        auto& page = pages.emplace_back();
+        page.vertex_buffer.init(device_manager, vertex_capacity * vertex_stride, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        page.vertex_buffer.count = vertex_capacity;
+        page.index_capacity = std::max(page_index_capacity, index_count);
+
+        return static_cast<uint32_t>(pages.size() - 1);
+    }
+
+    GeometryRange GeometryPool::append(UploadBatch& batch, const void* vertices, const uint32_t vertex_count, const uint16_t* indices, const uint32_t index_count, const void* skin_data)
+    {
+        if (vertex_count > UINT16_MAX)
+            log_error("too many vertices for 16 bit indices!");
+
+        return append(batch, vertices, vertex_count, static_cast<const void*>(indices), index_count, VK_INDEX_TYPE_UINT16, skin_data);
+    }
+
+    GeometryRange GeometryPool::append(UploadBatch& batch, const void* vertices, const uint32_t vertex_count, const uint32_t* indices, const uint32_t index_count, const void* skin_data)
+    {
+        return append(batch, vertices, vertex_count, static_cast<const void*>(indices), index_count, VK_INDEX_TYPE_UINT32, skin_data);
+    }
+
+    GeometryRange GeometryPool::append(UploadBatch& batch, const void* vertices, const uint32_t vertex_count, const void* indices, const uint32_t index_count, const VkIndexType index_type, const void* skin_data)
+    {
+        GeometryRange range{};
+        range.page = findPage(*batch.device_manager, vertex_count, index_count, index_type);
+        range.index_type = index_type;
+
+        auto& page = pages[range.page];
+        Buffer& index_buffer = index_type == VK_INDEX_TYPE_UINT16 ? page.index16_buffer : page.index32_buffer;
+        uint32_t& used_indices = index_type == VK_INDEX_TYPE_UINT16 ? page.index16_count : page.index32_count;
+
+        range.first_index = used_indices;
+        range.index_count = index_count;
+        range.vertex_offset = static_cast<int32_t>(page.vertex_count);
+        range.vertex_count = vertex_count;
+
+        if (index_buffer.handle == VK_NULL_HANDLE)
+        {
+            index_buffer.init(*batch.device_manager, page.index_capacity * indexSize(index_type), VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            index_buffer.count = page.index_capacity;
+        }
+
+        batch.uploadBuffer(page.vertex_buffer, vertices, vertex_count * vertex_stride, page.vertex_count * vertex_stride);
+        batch.uploadBuffer(index_buffer, indices, index_count * indexSize(index_type), used_indices * indexSize(index_type));
+
+        if (skin_data)
+        {
+            if (page.skin_buffer.handle == VK_NULL_HANDLE)
+            {
+                page.skin_buffer.init(*batch.device_manager, page.vertex_buffer.count * skin_stride, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+                page.skin_buffer.count = page.vertex_buffer.count;
+            }
+            batch.uploadBuffer(page.skin_buffer, skin_data, vertex_count * skin_stride, page.vertex_count * skin_stride);
+        }
+
+        page.vertex_count += vertex_count;
+        used_indices += index_count;
+
+        return range;
+    }
+
+    void GeometryPool::bind(VkCommandBuffer command_buffer, const uint32_t page, const VkIndexType index_type) const
+    {
+        // pipelines always read binding 1, a page without skinned meshes binds its vertices there instead. Only draws
+        // of static meshes can use it, which never look at their influences, and it is large enough to stay in bounds
+        const VkBuffer buffers[2] = { pages[page].vertex_buffer.handle, pages[page].skin_buffer.handle != VK_NULL_HANDLE ? pages[page].skin_buffer.handle : pages[page].vertex_buffer.handle };
+        const VkDeviceSize offsets[2] = { 0, 0 };
+        vkCmdBindVertexBuffers(command_buffer, 0, 2, buffers, offsets);
+
+        bindIndices(command_buffer, page, index_type);
+    }
+
+    void GeometryPool::bindIndices(VkCommandBuffer command_buffer, const uint32_t page, const VkIndexType index_type) const
+    {
+        const Buffer& index_buffer = index_type == VK_INDEX_TYPE_UINT16 ? pages[page].index16_buffer : pages[page].index32_buffer;
+        vkCmdBindIndexBuffer(command_buffer, index_buffer.handle, 0, index_type);
+    }
+}
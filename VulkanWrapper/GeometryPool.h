@@ -0,0 +1,69 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "Buffer.h"
+#include "DeviceManager.h"
+
+#include <vector>
+
+namespace VulkanWrapper
+{
+    struct UploadBatch;
+
+    // Where a mesh lives inside the GeometryPool, passed straight to vkCmdDrawIndexed
+    struct GeometryRange
+    {
+        uint32_t page = 0;
+        VkIndexType index_type = VK_INDEX_TYPE_UINT32;
+        uint32_t first_index = 0; // in elements of index_type
+        uint32_t index_count = 0;
+        int32_t vertex_offset = 0;
+        uint32_t vertex_count = 0;
+    };
+
+    struct GeometryPage
+    {
+        Buffer vertex_buffer;
+        Buffer skin_buffer; // created with the page's first skinned mesh, indexed like vertex_buffer
+        Buffer index16_buffer; // meshes with at most 65535 vertices, created with the page's first of them
+        Buffer index32_buffer; // created with the page's first mesh that needs 32 bit indices
+
+        uint32_t index_capacity = 0; // of either index buffer, which may not exist yet
+        uint32_t vertex_count = 0; // used, the vertex capacity is in the buffer
+        uint32_t index16_count = 0;
+        uint32_t index32_count = 0;
+    };
+
+    // Shared device local vertex and index buffers that meshes are appended into.
+    // The pool grows by adding pages rather than reallocating, so ranges handed out earlier stay valid
+    // and in flight frames never read a buffer that is being replaced. Nearly every scene fits in the first
+    // page, letting a frame bind geometry once and draw everything with firstIndex/vertexOffset.
+    // Skinned meshes add a second vertex stream (binding 1) that shares the vertex numbering, so vertexOffset
+    // addresses both.
+    struct GeometryPool
+    {
+        std::vector<GeometryPage> pages;
+
+        VkDeviceSize vertex_stride;
+        VkDeviceSize skin_stride; // no larger than vertex_stride
+        uint32_t page_vertex_capacity;
+        uint32_t page_index_capacity;
+
+        void init(const VkDeviceSize vertex_stride, const VkDeviceSize skin_stride, const uint32_t page_vertex_capacity = 1u << 20, const uint32_t page_index_capacity = 3u << 20);
+        void deinit(DeviceManager& device_manager);
+
+        // indices are relative to the mesh's first vertex, skin_data is vertex_count elements of skin_stride or null
+        GeometryRange append(UploadBatch& batch, const void* vertices, const uint32_t vertex_count, const uint16_t* indices, const uint32_t index_count, const void* skin_data = nullptr);
+        GeometryRange append(UploadBatch& batch, const void* vertices, const uint32_t vertex_count, const uint32_t* indices, const uint32_t index_count, const void* skin_data = nullptr);
+
+        void bind(VkCommandBuffer command_buffer, const uint32_t page, const VkIndexType index_type) const;
+        // only the page's index buffer, for draws whose vertices come from elsewhere
+        void bindIndices(VkCommandBuffer command_buffer, const uint32_t page, const VkIndexType index_type) const;
+
+    private:
+        uint32_t findPage(DeviceManager& device_manager, const uint32_t vertex_count, const uint32_t index_count, const VkIndexType index_type);
+        GeometryRange append(UploadBatch& batch, const void* vertices, const uint32_t vertex_count, const void* indices, const uint32_t index_count, const VkIndexType index_type, const void* skin_data);
+    };
+}
@@ -1,28 +1,19 @@
 #include "Image.h"
 #include "Log.h"
 #include "Buffer.h"
-#include "CommandBuffer.h"
+#include "DeviceManager.h"
+#include "UploadBatch.h"
+#include "../MipGenerator.h"
+#include "../TextureCompression.h"
 
-#include <stb/stb_image.h>
+#include <algorithm>
+#include <cstring>
+#include <vector>
 
 namespace VulkanWrapper
 {
-    static uint32_t findMemoryType(VkPhysicalDevice physical_device, uint32_t type_filter, VkMemoryPropertyFlags properties)
-    {
-        VkPhysicalDeviceMemoryProperties mem_properties;
-        vkGetPhysicalDeviceMemoryProperties(physical_device, &mem_properties);
-        for (uint32_t i{}; i < mem_properties.memoryTypeCount; ++i)
-        {
-            if ((type_filter & (1 << i)) && (mem_properties.memoryTypes[i].propertyFlags & properties) == properties)
-                return i;
-        }
-
-        log_error("failed to find suitable memory type!");
-    }
-
     void Image::createImage(
-        VkDevice logical_device,
-        VkPhysicalDevice physical_device,
+        DeviceManager& device_manager,
         const uint32_t width,
         const uint32_t height,
         uint32_t mip_map_levels,
@@ -52,64 +43,34 @@ namespace VulkanWrapper
         imageInfo.samples = num_samples;
         imageInfo.flags = 0;
 
-        if (vkCreateImage(logical_device, &imageInfo, nullptr, &handle) != VK_SUCCESS)
+        if (vkCreateImage(device_manager.logicalDevice, &imageInfo, nullptr, &handle) != VK_SUCCESS)
             log_error("failed to create image!");
 
         VkMemoryRequirements mem_requirements;
-        vkGetImageMemoryRequirements(logical_device, handle, &mem_requirements);
-
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = mem_requirements.size;
-        allocInfo.memoryTypeIndex = findMemoryType(physical_device, mem_requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        vkGetImageMemoryRequirements(device_manager.logicalDevice, handle, &mem_requirements);
 
-        if (vkAllocateMemory(logical_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
-            log_error("failed to allocate image memory");
+        allocation = device_manager.allocator.allocate(mem_requirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, tiling == VK_IMAGE_TILING_LINEAR);
 
-        vkBindImageMemory(logical_device, handle, memory, 0);
+        vkBindImageMemory(device_manager.logicalDevice, handle, allocation.memory, allocation.offset);
     }
 
-    void Image::deinit(VkDevice logical_device) {
-        vkDestroyImageView(logical_device, view, nullptr);
-        vkDestroyImage(logical_device, handle, nullptr);
-        vkFreeMemory(logical_device, memory, nullptr);
+    void Image::deinit(DeviceManager& device_manager) {
+        vkDestroyImageView(device_manager.logicalDevice, view, nullptr);
+        vkDestroyImage(device_manager.logicalDevice, handle, nullptr);
+        device_manager.allocator.free(allocation);
     }
 
-    void Texture::init(const DeviceManager& device_manager, const std::string& texture_path)
+    void Texture::init(DeviceManager& device_manager, UploadBatch& upload_batch, const TextureData& texture_data, const SamplerState& sampler_state)
     {
-        uploadTextureData(device_manager, image, texture_path);
+        uploadTextureData(upload_batch, image, texture_data);
 
-        {
-            VkPhysicalDeviceProperties properties{};
-            vkGetPhysicalDeviceProperties(device_manager.physicalDevice, &properties);
-
-            VkSamplerCreateInfo samplerInfo{};
-            samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-            samplerInfo.magFilter = VK_FILTER_LINEAR;
-            samplerInfo.minFilter = VK_FILTER_LINEAR;
-            samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-            samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-            samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-            samplerInfo.anisotropyEnable = VK_TRUE;
-            samplerInfo.maxAnisotropy = properties.limits.maxSamplerAnisotropy;
-            samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-            samplerInfo.unnormalizedCoordinates = VK_FALSE;
-            samplerInfo.compareEnable = VK_FALSE;
-            samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-            samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-            samplerInfo.mipLodBias = 0.0f;
-            samplerInfo.minLod = 0.0f;
-            samplerInfo.maxLod = static_cast<float>(image.mip_map_levels);
-
-            if (vkCreateSampler(device_manager.logicalDevice, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
-                log_error("failed to create texture sampler!");
-        }
+        sampler = device_manager.sampler_cache.get(sampler_state);
     }
 
-    void Texture::deinit(VkDevice logical_device)
+    void Texture::deinit(DeviceManager& device_manager)
     {
-        image.deinit(logical_device);
-        vkDestroySampler(logical_device, sampler, nullptr);
+        // the sampler belongs to the device's sampler cache
+        image.deinit(device_manager);
     }
 
     void createImageView(VkDevice logical_device, Image& image, VkImageAspectFlags aspect_flags)
@@ -133,11 +94,8 @@ namespace VulkanWrapper
             log_error("Failed to create swapchain image views!");
     }
 
-    void transitionLayout(const DeviceManager& device_manager, Image& image, VkImageLayout src_layout, VkImageLayout dest_layout)
+    void transitionLayout(VkCommandBuffer command_buffer, Image& image, VkImageLayout src_layout, VkImageLayout dest_layout, uint32_t base_level, uint32_t level_count)
     {
-        SingleTimeCommandBuffer command_buffer;
-        command_buffer.begin(device_manager);
-
         VkImageMemoryBarrier barrier{};
         barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
         barrier.oldLayout = src_layout;
@@ -145,8 +103,8 @@ namespace VulkanWrapper
         barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
         barrier.image = image.handle;
-        barrier.subresourceRange.baseMipLevel = 0;
-        barrier.subresourceRange.levelCount = image.mip_map_levels;
+        barrier.subresourceRange.baseMipLevel = base_level;
+        barrier.subresourceRange.levelCount = level_count;
         barrier.subresourceRange.baseArrayLayer = 0;
         barrier.subresourceRange.layerCount = 1;
 
@@ -175,6 +133,20 @@ namespace VulkanWrapper
             sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
             destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
         }
+        else if (src_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && dest_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL)
+        {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        }
+        else if (src_layout == VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL && dest_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL)
+        {
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+            destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        }
         else if (src_layout == VK_IMAGE_LAYOUT_UNDEFINED && dest_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL)
         {
             barrier.srcAccessMask = 0;
@@ -185,37 +157,126 @@ namespace VulkanWrapper
         else
             log_error("unsupported layout transtion!");
 
-        vkCmdPipelineBarrier(command_buffer.getHandle(), sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-
-        command_buffer.end(device_manager);
+        vkCmdPipelineBarrier(command_buffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
     }
 
-    void uploadTextureData(const DeviceManager& device_manager, Image& image, const std::string& texture_path)
+    bool supportsLinearBlit(VkPhysicalDevice physical_device, VkFormat format)
     {
-        int texWidth, texHeight, texChannels;
-        stbi_uc* pixels = stbi_load(texture_path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(physical_device, format, &properties);
 
-        uint32_t mipLevels = 1;
-
-        const VkDeviceSize imageSize = texWidth * texHeight * 4;
-        // mipLevels = static_cast<uint32_t>(std::floor(std::log2(std::max(texWidth, texHeight)))) + 1;
+        const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (properties.optimalTilingFeatures & required) == required;
+    }
 
-        Buffer stagingBuffer;
-        stagingBuffer.init(device_manager.physicalDevice, device_manager.logicalDevice, imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        uploadData(stagingBuffer, device_manager.logicalDevice, pixels);
+    void generateMipMaps(VkCommandBuffer command_buffer, Image& image, uint32_t first_level)
+    {
+        for (uint32_t level = first_level; level < image.mip_map_levels; ++level)
+        {
+            // each level is read once it has been written, by the copy or the previous blit
+            transitionLayout(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, level - 1, 1);
+
+            VkImageBlit blit{};
+            blit.srcOffsets[0] = { 0, 0, 0 };
+            blit.srcOffsets[1] = { int32_t(std::max(1u, image.width >> (level - 1))), int32_t(std::max(1u, image.height >> (level - 1))), 1 };
+            blit.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.srcSubresource.mipLevel = level - 1;
+            blit.srcSubresource.baseArrayLayer = 0;
+            blit.srcSubresource.layerCount = 1;
+            blit.dstOffsets[0] = { 0, 0, 0 };
+            blit.dstOffsets[1] = { int32_t(std::max(1u, image.width >> level)), int32_t(std::max(1u, image.height >> level)), 1 };
+            blit.dstSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            blit.dstSubresource.mipLevel = level;
+            blit.dstSubresource.baseArrayLayer = 0;
+            blit.dstSubresource.layerCount = 1;
+
+            vkCmdBlitImage(command_buffer, image.handle, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image.handle, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+        }
 
-        stbi_image_free(pixels);
+        // levels that were never a blit source are still transfer destinations
+        const uint32_t first_source = first_level - 1;
+        const uint32_t last_level = image.mip_map_levels - 1;
+        if (first_source > 0)
+            transitionLayout(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 0, first_source);
+        if (last_level > first_source)
+            transitionLayout(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, first_source, last_level - first_source);
+        transitionLayout(command_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, last_level, 1);
+    }
 
-        image.createImage(device_manager.logicalDevice, device_manager.physicalDevice, texWidth, texHeight, mipLevels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    bool supportsCompressedFormat(DeviceManager& device_manager, VkFormat format)
+    {
+        const bool bc = format == VK_FORMAT_BC1_RGB_SRGB_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK || format == VK_FORMAT_BC3_SRGB_BLOCK;
+        if (bc && !device_manager.enabled_features.textureCompressionBC)
+            return false;
 
-        transitionLayout(device_manager, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        VkFormatProperties properties;
+        vkGetPhysicalDeviceFormatProperties(device_manager.physicalDevice, format, &properties);
 
-        copyBufferToImage(device_manager, stagingBuffer, image);
+        const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+        return (properties.optimalTilingFeatures & required) == required;
+    }
 
-        //generateMipMaps(textureImage, VK_FORMAT_R8G8B8A8_SRGB, texWidth, texHeight, mipLevels);
-        transitionLayout(device_manager, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    void uploadTextureData(UploadBatch& upload_batch, Image& image, const TextureData& texture_data)
+    {
+        DeviceManager& device_manager = *upload_batch.device_manager;
+        const uint32_t full_levels = std::min(mipLevelCount(texture_data.width, texture_data.height), TextureData::max_levels);
+        const uint32_t provided_levels = std::min(texture_data.level_count, full_levels);
 
-        stagingBuffer.deinit(device_manager.logicalDevice);
+        if (isBlockCompressed(texture_data.format))
+        {
+            // blits can't write compressed images, so these get exactly the levels they come with
+            if (supportsCompressedFormat(device_manager, texture_data.format))
+            {
+                image.createImage(device_manager, texture_data.width, texture_data.height, provided_levels, VK_SAMPLE_COUNT_1_BIT, texture_data.format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+                upload_batch.uploadImage(image, texture_data.levels, provided_levels);
+            }
+            else
+            {
+                // no hardware support, decompress every level to RGBA8 instead
+                TextureData decompressed{};
+                decompressed.width = texture_data.width;
+                decompressed.height = texture_data.height;
+                decompressed.level_count = provided_levels;
+
+                std::vector<unsigned char> pixels(mipChainSize(texture_data.width, texture_data.height, provided_levels));
+                for (uint32_t level = 0; level < provided_levels; ++level)
+                {
+                    unsigned char* level_pixels = pixels.data() + mipChainSize(texture_data.width, texture_data.height, level);
+                    decompressImage(texture_data.format, static_cast<const unsigned char*>(texture_data.levels[level].data),
+                        std::max(1u, texture_data.width >> level), std::max(1u, texture_data.height >> level), level_pixels);
+                    decompressed.levels[level] = { level_pixels, textureLevelSize(VK_FORMAT_R8G8B8A8_SRGB, texture_data.width, texture_data.height, level) };
+                }
+
+                uploadTextureData(upload_batch, image, decompressed);
+                return;
+            }
+        }
+        else
+        {
+            const VkFormat format = texture_data.format;
+            image.createImage(device_manager, texture_data.width, texture_data.height, full_levels, VK_SAMPLE_COUNT_1_BIT, format, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+
+            // missing levels are blitted on the GPU, unless the format can't be linearly filtered by blits
+            if (provided_levels == full_levels || supportsLinearBlit(device_manager.physicalDevice, format))
+            {
+                upload_batch.uploadImage(image, texture_data.levels, provided_levels);
+            }
+            else
+            {
+                std::vector<unsigned char> chain(mipChainSize(texture_data.width, texture_data.height, full_levels));
+                TextureData::Level levels[TextureData::max_levels];
+                for (uint32_t level = 0; level < full_levels; ++level)
+                {
+                    unsigned char* level_pixels = chain.data() + mipChainSize(texture_data.width, texture_data.height, level);
+                    levels[level] = { level_pixels, textureLevelSize(format, texture_data.width, texture_data.height, level) };
+                    if (level < provided_levels)
+                        memcpy(level_pixels, texture_data.levels[level].data, (size_t)levels[level].size);
+                }
+                generateMipChain(chain.data(), texture_data.width, texture_data.height, provided_levels, full_levels);
+
+                upload_batch.uploadImage(image, levels, full_levels);
+            }
+        }
 
         createImageView(device_manager.logicalDevice, image, VK_IMAGE_ASPECT_COLOR_BIT);
     }
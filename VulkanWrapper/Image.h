@@ -3,16 +3,21 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "MemoryAllocator.h"
+#include "SamplerCache.h"
+#include "UploadQueue.h"
+
 #include <string>
 
 namespace VulkanWrapper
 {
     struct DeviceManager;
+    struct UploadBatch;
 
     struct Image
     {
         VkImage handle;
-        VkDeviceMemory memory;
+        MemoryAllocation allocation;
         VkImageView view;
 
         uint32_t width;
@@ -21,8 +26,7 @@ namespace VulkanWrapper
         VkFormat format;
 
         void createImage(
-            VkDevice logical_device,
-            VkPhysicalDevice physical_device,
+            DeviceManager& device_manager,
             const uint32_t width,
             const uint32_t height,
             uint32_t mipMapLevels,
@@ -31,21 +35,55 @@ namespace VulkanWrapper
             const VkImageTiling tiling,
             const VkImageUsageFlags usage);
 
-        void deinit(VkDevice logical_device);
+        void deinit(DeviceManager& device_manager);
+    };
+
+    // Texel data ready for upload, RGBA8 or one of the block compressed formats from TextureCompression.h.
+    // Only referenced, so the levels can come straight from a mapped cooked texture. RGBA8 textures may leave out
+    // levels, which are generated on upload, compressed ones get exactly the levels they come with
+    struct TextureData
+    {
+        static constexpr uint32_t max_levels = 16;
+
+        struct Level
+        {
+            const void* data;
+            VkDeviceSize size;
+        };
+
+        uint32_t width = 0;
+        uint32_t height = 0;
+        VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+        uint32_t level_count = 1;
+        Level levels[max_levels] = {};
     };
 
     struct Texture
     {
         Image image;
-        VkSampler sampler;
+        VkSampler sampler; // shared, owned by the device's SamplerCache
         std::string path;
+        UploadToken upload; // only sample it once this has completed
+        uint32_t generation = 0; // bumped whenever the image is replaced (see TextureStreamer), descriptors must be rewritten then
 
-        void init(const DeviceManager& device_manager, const std::string& texture_path);
+        void init(DeviceManager& device_manager, UploadBatch& upload_batch, const TextureData& texture_data, const SamplerState& sampler_state = {});
 
-        void deinit(VkDevice logical_device);
+        void deinit(DeviceManager& device_manager);
     };
 
     void createImageView(VkDevice logical_device, Image& image, VkImageAspectFlags aspect_flags);
 
-    void uploadTextureData(const DeviceManager& device_manager, Image& image, const std::string& texture_path);
+    void transitionLayout(VkCommandBuffer command_buffer, Image& image, VkImageLayout src_layout, VkImageLayout dest_layout, uint32_t base_level = 0, uint32_t level_count = VK_REMAINING_MIP_LEVELS);
+
+    // whether generateMipMaps can be used for images of this format
+    bool supportsLinearBlit(VkPhysicalDevice physical_device, VkFormat format);
+
+    // whether the device can sample this block compressed format with linear filtering
+    bool supportsCompressedFormat(DeviceManager& device_manager, VkFormat format);
+
+    // Blits levels [first_level, mip_map_levels) down from level first_level - 1. Needs a graphics queue.
+    // Expects every level in TRANSFER_DST_OPTIMAL and leaves all of them in SHADER_READ_ONLY_OPTIMAL
+    void generateMipMaps(VkCommandBuffer command_buffer, Image& image, uint32_t first_level);
+
+    void uploadTextureData(UploadBatch& upload_batch, Image& image, const TextureData& texture_data);
 }
\ No newline at end of file
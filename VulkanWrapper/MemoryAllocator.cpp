@@ -0,0 +1,236 @@
+#include "MemoryAllocator.h"
+#include "Log.h"
+
+#include <algorithm>
+
+namespace VulkanWrapper
+{
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void MemoryAllocator::init(VkPhysicalDevice physical_device, VkDevice logical_device)
+    {
+        this->physical_device = physical_device;
+        this->logical_device = logical_device;
+
+        vkGetPhysicalDeviceMemoryProperties(physical_device, &memory_properties);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        max_allocation_count = properties.limits.maxMemoryAllocationCount;
+    }
+
+    void MemoryAllocator::deinit()
+    {
+        for (auto& block : blocks)
+        {
+            if (block.memory == VK_NULL_HANDLE)
+                continue;
+
+            if (block.used != 0)
+                log_warning("Device memory block still has live allocations at shutdown\n");
+
+            vkFreeMemory(logical_device, block.memory, nullptr);
+        }
+
+        blocks.clear();
+    }
+
+    uint32_t MemoryAllocator::findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const
+    {
+        for (uint32_t i{}; i < memory_properties.memoryTypeCount; ++i)
+        {
+            if ((type_filter & (1 << i)) && (memory_properties.memoryTypes[i].propertyFlags & properties) == properties)
+                return i;
+        }
+
+        log_error("failed to find suitable memory type!");
+        return 0;
+    }
+
+    VkDeviceSize MemoryAllocator::blockSize(uint32_t memory_type) const
+    {
+        // small heaps (e.g. the 256MB host visible device local heap) get proportionally smaller blocks
+        const VkDeviceSize heap_size = memory_properties.memoryHeaps[memory_properties.memoryTypes[memory_type].heapIndex].size;
+        return std::min(default_block_size, heap_size / 8);
+    }
+
+    VkDeviceMemory MemoryAllocator::allocateDeviceMemory(VkDeviceSize size, uint32_t memory_type, void** mapped)
+    {
+        if (allocation_count >= max_allocation_count)
+            log_error("maxMemoryAllocationCount exceeded!");
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = size;
+        allocInfo.memoryTypeIndex = memory_type;
+
+        VkDeviceMemory memory;
+        if (vkAllocateMemory(logical_device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+            log_error("failed to allocate device memory!");
+
+        ++allocation_count;
+
+        *mapped = nullptr;
+        if (memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT)
+        {
+            if (vkMapMemory(logical_device, memory, 0, size, 0, mapped) != VK_SUCCESS)
+                log_error("failed to map device memory!");
+        }
+
+        return memory;
+    }
+
+    uint32_t MemoryAllocator::createBlock(uint32_t memory_type, bool linear, VkDeviceSize size)
+    {
+        uint32_t block_index = 0;
+        while (block_index < blocks.size() && blocks[block_index].memory != VK_NULL_HANDLE)
+            ++block_index;
+        if (block_index == blocks.size())
+            blocks.emplace_back();
+
+        MemoryBlock& block = blocks[block_index];
+        block.memory = allocateDeviceMemory(size, memory_type, &block.mapped);
+        block.size = size;
+        block.used = 0;
+        block.memory_type = memory_type;
+        block.linear = linear;
+        block.free_ranges = { { 0, size } };
+
+        return block_index;
+    }
+
+    void MemoryAllocator::releaseBlock(uint32_t block_index)
+    {
+        MemoryBlock& block = blocks[block_index];
+
+        // keep one empty block around per memory type so alternating alloc/free does not thrash the driver
+        for (uint32_t i = 0; i < blocks.size(); ++i)
+        {
+            if (i == block_index || blocks[i].memory == VK_NULL_HANDLE)
+                continue;
+
+            if (blocks[i].memory_type == block.memory_type && blocks[i].linear == block.linear)
+            {
+                vkFreeMemory(logical_device, block.memory, nullptr);
+                --allocation_count;
+                block = MemoryBlock{};
+                return;
+            }
+        }
+    }
+
+    MemoryAllocation MemoryAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear)
+    {
+        MemoryAllocation allocation{};
+        allocation.memory_type = findMemoryType(requirements.memoryTypeBits, properties);
+        allocation.size = requirements.size;
+
+        const VkDeviceSize block_size = blockSize(allocation.memory_type);
+
+        // large resources get their own memory, sub-allocating them would just waste most of a block
+        if (requirements.size > block_size / 2)
+        {
+            allocation.memory = allocateDeviceMemory(requirements.size, allocation.memory_type, &allocation.mapped);
+            allocation.offset = 0;
+            allocation.block_index = MemoryAllocation::dedicated_block;
+            return allocation;
+        }
+
+        auto try_allocate = [&](uint32_t block_index)
+        {
+            MemoryBlock& block = blocks[block_index];
+
+            // first fit
+            for (size_t i = 0; i < block.free_ranges.size(); ++i)
+            {
+                const auto range = block.free_ranges[i];
+                const VkDeviceSize aligned_offset = alignUp(range.offset, requirements.alignment);
+                if (aligned_offset + requirements.size > range.offset + range.size)
+                    continue;
+
+                const VkDeviceSize padding = aligned_offset - range.offset;
+                const VkDeviceSize remainder = range.size - padding - requirements.size;
+
+                // the alignment padding stays in the free list, the allocation only covers its own bytes
+                block.free_ranges.erase(block.free_ranges.begin() + i);
+                if (remainder > 0)
+                    block.free_ranges.insert(block.free_ranges.begin() + i, { aligned_offset + requirements.size, remainder });
+                if (padding > 0)
+                    block.free_ranges.insert(block.free_ranges.begin() + i, { range.offset, padding });
+
+                block.used += requirements.size;
+
+                allocation.memory = block.memory;
+                allocation.offset = aligned_offset;
+                allocation.mapped = block.mapped ? static_cast<char*>(block.mapped) + aligned_offset : nullptr;
+                allocation.block_index = block_index;
+                return true;
+            }
+
+            return false;
+        };
+
+        for (uint32_t i = 0; i < blocks.size(); ++i)
+        {
+            const auto& block = blocks[i];
+            if (block.memory == VK_NULL_HANDLE || block.memory_type != allocation.memory_type || block.linear != linear)
+                continue;
+
+            if (block.size - block.used >= requirements.size && try_allocate(i))
+                return allocation;
+        }
+
+        if (!try_allocate(createBlock(allocation.memory_type, linear, block_size)))
+            log_error("failed to sub-allocate from a new memory block!");
+
+        return allocation;
+    }
+
+    void MemoryAllocator::free(MemoryAllocation& allocation)
+    {
+        if (allocation.memory == VK_NULL_HANDLE)
+            return;
+
+        if (allocation.block_index == MemoryAllocation::dedicated_block)
+        {
+            vkFreeMemory(logical_device, allocation.memory, nullptr);
+            --allocation_count;
+            allocation = MemoryAllocation{};
+            return;
+        }
+
+        MemoryBlock& block = blocks[allocation.block_index];
+        auto& ranges = block.free_ranges;
+
+        auto next = std::lower_bound(ranges.begin(), ranges.end(), allocation.offset, [](const MemoryBlock::FreeRange& range, VkDeviceSize offset) { return range.offset < offset; });
+        auto inserted = ranges.insert(next, { allocation.offset, allocation.size });
+
+        // merge with the following range
+        auto following = inserted + 1;
+        if (following != ranges.end() && inserted->offset + inserted->size == following->offset)
+        {
+            inserted->size += following->size;
+            ranges.erase(following);
+        }
+
+        // merge with the preceding range
+        if (inserted != ranges.begin())
+        {
+            auto preceding = inserted - 1;
+            if (preceding->offset + preceding->size == inserted->offset)
+            {
+                preceding->size += inserted->size;
+                ranges.erase(inserted);
+            }
+        }
+
+        block.used -= allocation.size;
+        if (block.used == 0)
+            releaseBlock(allocation.block_index);
+
+        allocation = MemoryAllocation{};
+    }
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <vector>
+
+namespace VulkanWrapper
+{
+    // A sub-range of a device memory block handed out by the MemoryAllocator
+    struct MemoryAllocation
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize offset = 0;
+        VkDeviceSize size = 0;
+        void* mapped = nullptr; // only set for host visible memory, which is kept persistently mapped
+
+        uint32_t memory_type = 0;
+        uint32_t block_index = 0; // dedicated_block for allocations with their own VkDeviceMemory
+
+        static constexpr uint32_t dedicated_block = UINT32_MAX;
+    };
+
+    struct MemoryBlock
+    {
+        struct FreeRange
+        {
+            VkDeviceSize offset;
+            VkDeviceSize size;
+        };
+
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        VkDeviceSize used = 0;
+        void* mapped = nullptr;
+
+        uint32_t memory_type = 0;
+        bool linear = true; // buffers and linear images never share a block with optimal images, so bufferImageGranularity can be ignored
+
+        std::vector<FreeRange> free_ranges; // sorted by offset, adjacent ranges are always merged
+    };
+
+    struct MemoryAllocator
+    {
+        VkPhysicalDevice physical_device = VK_NULL_HANDLE;
+        VkDevice logical_device = VK_NULL_HANDLE;
+        VkPhysicalDeviceMemoryProperties memory_properties;
+
+        VkDeviceSize default_block_size = 64ull * 1024 * 1024;
+        uint32_t max_allocation_count;
+        uint32_t allocation_count = 0; // live vkAllocateMemory calls, blocks and dedicated allocations
+
+        std::vector<MemoryBlock> blocks; // released blocks keep their slot (memory == VK_NULL_HANDLE) so block indices stay valid
+
+        void init(VkPhysicalDevice physical_device, VkDevice logical_device);
+        void deinit();
+
+        uint32_t findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const;
+
+        MemoryAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear);
+        void free(MemoryAllocation& allocation);
+
+    private:
+        VkDeviceSize blockSize(uint32_t memory_type) const;
+        VkDeviceMemory allocateDeviceMemory(VkDeviceSize size, uint32_t memory_type, void** mapped);
+        uint32_t createBlock(uint32_t memory_type, bool linear, VkDeviceSize size);
+        void releaseBlock(uint32_t block_index);
+    };
+}
\ No newline at end of file
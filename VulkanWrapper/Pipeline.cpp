@@ -8,7 +8,7 @@
 
 namespace VulkanWrapper
 {
-    void Pipeline::init(const DeviceManager& device_manager, const Swapchain& swapchain, const ShaderSettings& shader_settings)
+    void Pipeline::init(DeviceManager& device_manager, const Swapchain& swapchain, const ShaderSettings& shader_settings)
     {
         this->shader_settings = shader_settings;
         this->swapchain_image_size = swapchain.images.size();
@@ -16,7 +16,7 @@ namespace VulkanWrapper
         reinit(device_manager, swapchain);
     }
 
-    void Pipeline::reinit(const DeviceManager& device_manager, const Swapchain& swapchain)
+    void Pipeline::reinit(DeviceManager& device_manager, const Swapchain& swapchain)
     {
         if (swapchain.images.size() != swapchain_image_size) {
             log_error("Swapchain images size has changed!");
@@ -111,8 +111,8 @@ namespace VulkanWrapper
 
             VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
             vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-            vertexInputInfo.vertexBindingDescriptionCount = 1;
-            vertexInputInfo.pVertexBindingDescriptions = &shader_settings.binding_description;
+            vertexInputInfo.vertexBindingDescriptionCount = shader_settings.binding_descriptions_count;
+            vertexInputInfo.pVertexBindingDescriptions = shader_settings.binding_descriptions;
             vertexInputInfo.vertexAttributeDescriptionCount = shader_settings.input_attribute_descriptions_count;
             vertexInputInfo.pVertexAttributeDescriptions = shader_settings.input_attribute_descriptions;
 
@@ -198,8 +198,8 @@ namespace VulkanWrapper
             pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
             pipelineLayoutInfo.setLayoutCount = shader_settings.descriptor_set_layouts.size();
             pipelineLayoutInfo.pSetLayouts = &layouts[0];
-            pipelineLayoutInfo.pushConstantRangeCount = 0;
-            pipelineLayoutInfo.pPushConstantRanges = nullptr;
+            pipelineLayoutInfo.pushConstantRangeCount = static_cast<uint32_t>(shader_settings.push_constant_ranges.size());
+            pipelineLayoutInfo.pPushConstantRanges = shader_settings.push_constant_ranges.data();
 
             if (vkCreatePipelineLayout(device_manager.logicalDevice, &pipelineLayoutInfo, nullptr, &pipeline_layout) != VK_SUCCESS)
                 log_error("failed to create pipeline layout!");
@@ -242,8 +242,7 @@ namespace VulkanWrapper
         // create colour and depth resources
         {
             colour_image.createImage(
-                device_manager.logicalDevice,
-                device_manager.physicalDevice,
+                device_manager,
                 swapchain.extent.width,
                 swapchain.extent.height,
                 1,
@@ -255,8 +254,7 @@ namespace VulkanWrapper
             createImageView(device_manager.logicalDevice, colour_image, VK_IMAGE_ASPECT_COLOR_BIT);
             
             depth_image.createImage(
-                device_manager.logicalDevice,
-                device_manager.physicalDevice,
+                device_manager,
                 swapchain.extent.width,
                 swapchain.extent.height,
                 1,
@@ -291,10 +289,10 @@ namespace VulkanWrapper
         }
     }
 
-    void Pipeline::deinit(const DeviceManager& device_manager, const bool pre_reinit)
+    void Pipeline::deinit(DeviceManager& device_manager, const bool pre_reinit)
     {
-        colour_image.deinit(device_manager.logicalDevice);
-        depth_image.deinit(device_manager.logicalDevice);
+        colour_image.deinit(device_manager);
+        depth_image.deinit(device_manager);
 
         for (auto& framebuffer : framebuffers)
             vkDestroyFramebuffer(device_manager.logicalDevice, framebuffer, nullptr);
@@ -28,9 +28,9 @@ namespace VulkanWrapper
 
         int swapchain_image_size;
 
-        void init(const DeviceManager& device_manager, const Swapchain& swapchain, const ShaderSettings& shader_settings);
-        void reinit(const DeviceManager& device_manager, const Swapchain& swapchain);
-        void deinit(const DeviceManager& device_manager, const bool pre_reinit);
+        void init(DeviceManager& device_manager, const Swapchain& swapchain, const ShaderSettings& shader_settings);
+        void reinit(DeviceManager& device_manager, const Swapchain& swapchain);
+        void deinit(DeviceManager& device_manager, const bool pre_reinit);
 
         void createDescriptorSets(const DeviceManager& device_manager, const std::vector<Texture*>& textures);
     };
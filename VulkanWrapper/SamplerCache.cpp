@@ -0,0 +1,82 @@
+#include "SamplerCache.h"
+#include "Log.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace VulkanWrapper
+{
+    static_assert(sizeof(SamplerState) == 14 * 4, "SamplerState must not contain padding, it is hashed bytewise");
+
+    bool SamplerState::operator==(const SamplerState& other) const
+    {
+        return memcmp(this, &other, sizeof(SamplerState)) == 0;
+    }
+
+    size_t SamplerStateHash::operator()(const SamplerState& state) const
+    {
+        const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&state);
+        size_t hash = 14695981039346656037ull;
+        for (size_t i = 0; i < sizeof(SamplerState); ++i)
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        return hash;
+    }
+
+    void SamplerCache::init(VkPhysicalDevice physical_device, VkDevice logical_device)
+    {
+        this->logical_device = logical_device;
+
+        VkPhysicalDeviceFeatures features{};
+        vkGetPhysicalDeviceFeatures(physical_device, &features);
+
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        max_anisotropy = features.samplerAnisotropy ? properties.limits.maxSamplerAnisotropy : 1.0f;
+    }
+
+    void SamplerCache::deinit()
+    {
+        for (auto& [state, sampler] : samplers)
+            vkDestroySampler(logical_device, sampler, nullptr);
+
+        samplers.clear();
+    }
+
+    VkSampler SamplerCache::get(const SamplerState& requested)
+    {
+        // clamp first, so requests differing only beyond the device limit share a sampler
+        SamplerState state = requested;
+        state.max_anisotropy = std::min(state.max_anisotropy, max_anisotropy);
+        if (state.max_anisotropy <= 1.0f)
+            state.max_anisotropy = 1.0f;
+
+        auto found = samplers.find(state);
+        if (found != samplers.end())
+            return found->second;
+
+        VkSamplerCreateInfo samplerInfo{};
+        samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        samplerInfo.magFilter = state.mag_filter;
+        samplerInfo.minFilter = state.min_filter;
+        samplerInfo.mipmapMode = state.mipmap_mode;
+        samplerInfo.addressModeU = state.address_mode_u;
+        samplerInfo.addressModeV = state.address_mode_v;
+        samplerInfo.addressModeW = state.address_mode_w;
+        samplerInfo.mipLodBias = state.mip_lod_bias;
+        samplerInfo.anisotropyEnable = state.max_anisotropy > 1.0f ? VK_TRUE : VK_FALSE;
+        samplerInfo.maxAnisotropy = state.max_anisotropy;
+        samplerInfo.compareEnable = state.compare_enable;
+        samplerInfo.compareOp = state.compare_op;
+        samplerInfo.minLod = state.min_lod;
+        samplerInfo.maxLod = state.max_lod;
+        samplerInfo.borderColor = state.border_color;
+        samplerInfo.unnormalizedCoordinates = state.unnormalized_coordinates;
+
+        VkSampler sampler;
+        if (vkCreateSampler(logical_device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+            log_error("failed to create texture sampler!");
+
+        samplers.emplace(state, sampler);
+        return sampler;
+    }
+}
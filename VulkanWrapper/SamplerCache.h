@@ -0,0 +1,49 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include <unordered_map>
+
+namespace VulkanWrapper
+{
+    // Everything a VkSampler is created from. Only 4 byte members, so it can be hashed and compared bytewise
+    struct SamplerState
+    {
+        VkFilter mag_filter = VK_FILTER_LINEAR;
+        VkFilter min_filter = VK_FILTER_LINEAR;
+        VkSamplerMipmapMode mipmap_mode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+        VkSamplerAddressMode address_mode_u = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        VkSamplerAddressMode address_mode_v = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        VkSamplerAddressMode address_mode_w = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+        float mip_lod_bias = 0.0f;
+        float max_anisotropy = 16.0f; // clamped to the device limit, 1 or less disables anisotropic filtering
+        float min_lod = 0.0f;
+        float max_lod = VK_LOD_CLAMP_NONE; // the image view already limits the levels, so one sampler suits every texture
+        VkBorderColor border_color = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+        VkBool32 compare_enable = VK_FALSE;
+        VkCompareOp compare_op = VK_COMPARE_OP_ALWAYS;
+        VkBool32 unnormalized_coordinates = VK_FALSE;
+
+        bool operator==(const SamplerState& other) const;
+    };
+
+    struct SamplerStateHash
+    {
+        size_t operator()(const SamplerState& state) const;
+    };
+
+    // Hands out one VkSampler per distinct SamplerState, samplers are owned by the cache and live until deinit
+    struct SamplerCache
+    {
+        VkDevice logical_device = VK_NULL_HANDLE;
+        float max_anisotropy = 1.0f;
+
+        std::unordered_map<SamplerState, VkSampler, SamplerStateHash> samplers;
+
+        void init(VkPhysicalDevice physical_device, VkDevice logical_device);
+        void deinit();
+
+        VkSampler get(const SamplerState& state);
+    };
+}
@@ -20,22 +20,94 @@ namespace VulkanWrapper
 
             lb.binding = binding_index;
             lb.descriptorType = bindings[binding_index].descriptor_type;
-            lb.descriptorCount = 1;
+            lb.descriptorCount = bindings[binding_index].descriptor_count;
             lb.stageFlags = bindings[binding_index].stage_flags;
             lb.pImmutableSamplers = nullptr;
         }
 
+        std::vector<VkDescriptorBindingFlags> binding_flags(bindings.size());
+        bool any_binding_flags = false;
+        for (uint32_t binding_index = 0; binding_index < bindings.size(); binding_index++)
+        {
+            binding_flags[binding_index] = bindings[binding_index].binding_flags;
+            any_binding_flags |= binding_flags[binding_index] != 0;
+        }
+
+        VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{};
+        binding_flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        binding_flags_info.bindingCount = static_cast<uint32_t>(binding_flags.size());
+        binding_flags_info.pBindingFlags = binding_flags.data();
+
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         layoutInfo.bindingCount = static_cast<uint32_t>(vkbindings.size());
         layoutInfo.pBindings = vkbindings.data();
 
+        if (any_binding_flags)
+        {
+            layoutInfo.pNext = &binding_flags_info;
+            if (updateAfterBind())
+                layoutInfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        }
+
         if (vkCreateDescriptorSetLayout(device_manager.logicalDevice, &layoutInfo, nullptr, &handle) != VK_SUCCESS)
             log_error("failed to create descriptor set layout");
+
+        // the template reads one DescriptorData per single binding, packed back to back
+        VkDescriptorUpdateTemplateEntry entries[max_bindings];
+        written_binding_count = 0;
+        for (uint32_t binding_index = 0; binding_index < bindings.size(); binding_index++)
+        {
+            if (bindings[binding_index].descriptor_count > 1)
+                continue;
+            if (written_binding_count == max_bindings)
+                log_error("too many descriptor bindings in one layout");
+
+            auto& entry = entries[written_binding_count];
+            entry.dstBinding = binding_index;
+            entry.dstArrayElement = 0;
+            entry.descriptorCount = 1;
+            entry.descriptorType = bindings[binding_index].descriptor_type;
+            entry.offset = written_binding_count * sizeof(DescriptorData);
+            entry.stride = sizeof(DescriptorData);
+            ++written_binding_count;
+        }
+
+        if (written_binding_count > 0)
+        {
+            VkDescriptorUpdateTemplateCreateInfo templateInfo{};
+            templateInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_UPDATE_TEMPLATE_CREATE_INFO;
+            templateInfo.descriptorUpdateEntryCount = written_binding_count;
+            templateInfo.pDescriptorUpdateEntries = entries;
+            templateInfo.templateType = VK_DESCRIPTOR_UPDATE_TEMPLATE_TYPE_DESCRIPTOR_SET;
+            templateInfo.descriptorSetLayout = handle;
+
+            if (vkCreateDescriptorUpdateTemplate(device_manager.logicalDevice, &templateInfo, nullptr, &update_template) != VK_SUCCESS)
+                log_error("failed to create descriptor update template");
+        }
+    }
+
+    void DescriptorSetLayout::write(VkDevice logical_device, VkDescriptorSet descriptor_set, const DescriptorData* data) const
+    {
+        if (update_template != VK_NULL_HANDLE)
+            vkUpdateDescriptorSetWithTemplate(logical_device, descriptor_set, update_template, data);
+    }
+
+    bool DescriptorSetLayout::updateAfterBind() const
+    {
+        for (const auto& binding : bindings)
+        {
+            if (binding.binding_flags & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT)
+                return true;
+        }
+        return false;
     }
 
     void DescriptorSetLayout::deinit(DeviceManager& device_manager)
     {
+        if (update_template != VK_NULL_HANDLE)
+            vkDestroyDescriptorUpdateTemplate(device_manager.logicalDevice, update_template, nullptr);
+        update_template = VK_NULL_HANDLE;
         vkDestroyDescriptorSetLayout(device_manager.logicalDevice, handle, nullptr);
     }
 
@@ -71,7 +143,7 @@ namespace VulkanWrapper
         // create shader stage
         {
             create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-            create_info.stage = type == Type::Vertex ? VK_SHADER_STAGE_VERTEX_BIT : VK_SHADER_STAGE_FRAGMENT_BIT;
+            create_info.stage = type == Type::Vertex ? VK_SHADER_STAGE_VERTEX_BIT : type == Type::Fragment ? VK_SHADER_STAGE_FRAGMENT_BIT : VK_SHADER_STAGE_COMPUTE_BIT;
             create_info.module = handle;
             create_info.pName = "main";
         }
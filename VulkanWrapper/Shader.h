@@ -15,18 +15,39 @@ namespace VulkanWrapper
         VkDescriptorType descriptor_type;
         VkShaderStageFlags stage_flags;
         VkDeviceSize uniform_data_size;
+        uint32_t descriptor_count = 1; // > 1 for descriptor arrays such as the bindless texture table
+        VkDescriptorBindingFlags binding_flags = 0; // UPDATE_AFTER_BIND makes the layout and its pool update after bind
+    };
+
+    // what a single descriptor binding is written from, see DescriptorSetLayout::write
+    union DescriptorData
+    {
+        VkDescriptorBufferInfo buffer;
+        VkDescriptorImageInfo image;
     };
 
     struct DescriptorSetLayout
     {
+        static constexpr uint32_t max_bindings = 16;
+
         std::vector<DescriptorSetLayoutInfo> bindings;
         bool update_per_frame = false;
         uint32_t count;
 
         VkDescriptorSetLayout handle;
 
+        // writes every single descriptor binding at once, descriptor arrays are left to their owners
+        VkDescriptorUpdateTemplate update_template = VK_NULL_HANDLE;
+        uint32_t written_binding_count = 0;
+
         void upload(DeviceManager& device_manager);
         void deinit(DeviceManager& device_manager);
+
+        // sets of this layout have to come from a pool created with UPDATE_AFTER_BIND
+        bool updateAfterBind() const;
+
+        // data holds written_binding_count entries, one per binding with a descriptor_count of 1 in binding order
+        void write(VkDevice logical_device, VkDescriptorSet descriptor_set, const DescriptorData* data) const;
     };
 
     struct ShaderSettings
@@ -34,18 +55,32 @@ namespace VulkanWrapper
         const char* vert_addr;
         const char* frag_addr;
 
-        VkVertexInputBindingDescription binding_description;
+        const VkVertexInputBindingDescription* binding_descriptions;
+        uint32_t binding_descriptions_count;
         const VkVertexInputAttributeDescription* input_attribute_descriptions;
         uint32_t input_attribute_descriptions_count;
 
         std::vector<DescriptorSetLayout> descriptor_set_layouts;
+
+        // small per draw data goes through vkCmdPushConstants, every device has at least 128 bytes of it
+        std::vector<VkPushConstantRange> push_constant_ranges;
+    };
+
+    struct ComputeShaderSettings
+    {
+        const char* comp_addr;
+
+        std::vector<DescriptorSetLayout> descriptor_set_layouts;
+        std::vector<VkPushConstantRange> push_constant_ranges;
+        std::vector<uint32_t> specialization_constants; // constant_id i is specialization_constants[i]
     };
     
     struct Shader
     {
         enum class Type {
             Vertex,
-            Fragment
+            Fragment,
+            Compute
         };
 
         VkShaderModule handle{};
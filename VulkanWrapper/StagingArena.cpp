@@ -0,0 +1,67 @@
+#include "StagingArena.h"
+#include "Log.h"
+
+namespace VulkanWrapper
+{
+    static void destroyChunk(VkDevice logical_device, MemoryAllocator& allocator, StagingChunk& chunk)
+    {
+        vkDestroyBuffer(logical_device, chunk.buffer, nullptr);
+        allocator.free(chunk.allocation);
+    }
+
+    void StagingArena::deinit(VkDevice logical_device, MemoryAllocator& allocator)
+    {
+        for (auto& chunk : free_chunks)
+            destroyChunk(logical_device, allocator, chunk);
+
+        free_chunks.clear();
+    }
+
+    StagingChunk StagingArena::acquireChunk(VkDevice logical_device, MemoryAllocator& allocator, const VkDeviceSize min_size)
+    {
+        for (size_t i = 0; i < free_chunks.size(); ++i)
+        {
+            if (free_chunks[i].size >= min_size)
+            {
+                StagingChunk chunk = free_chunks[i];
+                free_chunks.erase(free_chunks.begin() + i);
+                chunk.head = 0;
+                return chunk;
+            }
+        }
+
+        StagingChunk chunk{};
+        chunk.size = min_size > chunk_size ? min_size : chunk_size;
+
+        VkBufferCreateInfo bufferInfo{};
+        bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        bufferInfo.size = chunk.size;
+        bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(logical_device, &bufferInfo, nullptr, &chunk.buffer) != VK_SUCCESS)
+            log_error("failed to create staging buffer!");
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(logical_device, chunk.buffer, &memRequirements);
+
+        chunk.allocation = allocator.allocate(memRequirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+        vkBindBufferMemory(logical_device, chunk.buffer, chunk.allocation.memory, chunk.allocation.offset);
+
+        return chunk;
+    }
+
+    void StagingArena::releaseChunks(VkDevice logical_device, MemoryAllocator& allocator, std::vector<StagingChunk>& chunks)
+    {
+        for (auto& chunk : chunks)
+        {
+            // oversized chunks were made for a single large resource, don't hold on to them
+            if (chunk.size > chunk_size || free_chunks.size() >= max_free_chunks)
+                destroyChunk(logical_device, allocator, chunk);
+            else
+                free_chunks.push_back(chunk);
+        }
+
+        chunks.clear();
+    }
+}
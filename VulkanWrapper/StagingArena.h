@@ -0,0 +1,42 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "MemoryAllocator.h"
+
+#include <vector>
+
+namespace VulkanWrapper
+{
+    // A host visible transfer source buffer that upload batches bump allocate from
+    struct StagingChunk
+    {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        MemoryAllocation allocation;
+        VkDeviceSize size = 0;
+        VkDeviceSize head = 0;
+    };
+
+    struct StagingAllocation
+    {
+        VkBuffer buffer;
+        VkDeviceSize offset;
+        void* data;
+    };
+
+    // Shared pool of staging chunks. Batches take chunks while recording and hand them back once
+    // the GPU has finished the copies, so staging memory is recycled instead of allocated per resource.
+    struct StagingArena
+    {
+        VkDeviceSize chunk_size = 16ull * 1024 * 1024;
+        size_t max_free_chunks = 4;
+
+        std::vector<StagingChunk> free_chunks;
+
+        void deinit(VkDevice logical_device, MemoryAllocator& allocator);
+
+        StagingChunk acquireChunk(VkDevice logical_device, MemoryAllocator& allocator, const VkDeviceSize min_size);
+        void releaseChunks(VkDevice logical_device, MemoryAllocator& allocator, std::vector<StagingChunk>& chunks);
+    };
+}
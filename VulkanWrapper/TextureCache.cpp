@@ -0,0 +1,74 @@
+#include "TextureCache.h"
+#include "Log.h"
+
+#include <filesystem>
+
+namespace VulkanWrapper
+{
+    std::string TextureCache::canonicalPath(const std::string& path)
+    {
+        if (path.empty())
+            return path;
+
+        std::error_code error;
+        const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, error);
+        return error ? std::filesystem::path(path).lexically_normal().generic_string() : canonical.generic_string();
+    }
+
+    Texture* TextureCache::acquire(const std::string& canonical_path)
+    {
+        auto found = entries.find(canonical_path);
+        if (found == entries.end())
+            return nullptr;
+
+        ++found->second->ref_count;
+        return &found->second->texture;
+    }
+
+    Texture* TextureCache::add(DeviceManager& device_manager, UploadBatch& upload_batch, const std::string& canonical_path, const TextureData& texture_data, const SamplerState& sampler_state)
+    {
+        auto& entry = entries[canonical_path];
+        if (entry)
+        {
+            log_warning(("texture " + canonical_path + " is already cached\n").c_str());
+            ++entry->ref_count;
+            return &entry->texture;
+        }
+
+        entry = std::make_unique<Entry>();
+        entry->ref_count = 1;
+        entry->texture.path = canonical_path;
+        entry->texture.init(device_manager, upload_batch, texture_data, sampler_state);
+        return &entry->texture;
+    }
+
+    void TextureCache::release(DeviceManager& device_manager, Texture* texture)
+    {
+        if (!texture)
+            return;
+
+        auto found = entries.find(texture->path);
+        if (found == entries.end() || &found->second->texture != texture)
+        {
+            log_warning("released a texture the cache does not own\n");
+            return;
+        }
+
+        if (--found->second->ref_count == 0)
+        {
+            found->second->texture.deinit(device_manager);
+            entries.erase(found);
+        }
+    }
+
+    void TextureCache::deinit(DeviceManager& device_manager)
+    {
+        if (!entries.empty())
+            log_warning("textures still referenced at shutdown\n");
+
+        for (auto& [path, entry] : entries)
+            entry->texture.deinit(device_manager);
+
+        entries.clear();
+    }
+}
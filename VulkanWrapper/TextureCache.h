@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Image.h"
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace VulkanWrapper
+{
+    struct DeviceManager;
+    struct UploadBatch;
+
+    // Textures shared between everything that references the same file, keyed by canonical path.
+    // Each acquire or add takes a reference, the texture is destroyed when the last one is released.
+    // Texture pointers stay valid until then.
+    struct TextureCache
+    {
+        struct Entry
+        {
+            Texture texture;
+            uint32_t ref_count = 0;
+        };
+
+        std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+
+        // resolves relative segments and separators, so different spellings of a path share one entry
+        static std::string canonicalPath(const std::string& path);
+
+        // takes a reference to an already cached texture, nullptr if canonical_path isn't cached
+        Texture* acquire(const std::string& canonical_path);
+
+        // creates the texture, recording its upload into upload_batch, and returns it with one reference
+        Texture* add(DeviceManager& device_manager, UploadBatch& upload_batch, const std::string& canonical_path, const TextureData& texture_data, const SamplerState& sampler_state = {});
+
+        // the caller must make sure the GPU has finished with the texture before dropping the last reference
+        void release(DeviceManager& device_manager, Texture* texture);
+
+        void deinit(DeviceManager& device_manager);
+    };
+}
@@ -0,0 +1,94 @@
+#include "TextureTable.h"
+#include "Image.h"
+#include "Log.h"
+
+namespace VulkanWrapper
+{
+    void TextureTable::init(VkDevice logical_device, DescriptorPool& descriptor_pool, const DescriptorSetLayout& layout, uint32_t frames_in_flight)
+    {
+        if (layout.bindings.empty() || layout.bindings[binding].descriptor_type != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER)
+            log_error("TextureTable layout must start with a combined image sampler array");
+
+        this->frames_in_flight = frames_in_flight;
+        capacity = layout.bindings[binding].descriptor_count;
+
+        // the array is partially bound, so the set starts out without any descriptors written
+        descriptor_set = descriptor_pool.createDescriptorSet(layout, {}, {});
+    }
+
+    void TextureTable::deinit()
+    {
+        // the set is freed with its pool
+        descriptor_set = VK_NULL_HANDLE;
+        slots.clear();
+        retired.clear();
+        free_slots.clear();
+        next_slot = 0;
+    }
+
+    void TextureTable::beginFrame()
+    {
+        ++frame;
+
+        // no frame in flight can still index these
+        for (size_t i = 0; i < retired.size();)
+        {
+            if (frame >= retired[i].frame + frames_in_flight)
+            {
+                free_slots.push_back(retired[i].index);
+                retired[i] = retired.back();
+                retired.pop_back();
+            }
+            else
+                ++i;
+        }
+    }
+
+    uint32_t TextureTable::index(VkDevice logical_device, const Texture& texture)
+    {
+        auto found = slots.find(&texture);
+        if (found != slots.end() && found->second.generation == texture.generation)
+            return found->second.index;
+
+        uint32_t slot;
+        if (!free_slots.empty())
+        {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        else if (next_slot < capacity)
+            slot = next_slot++;
+        else
+        {
+            log_warning("texture table is full\n");
+            return found != slots.end() ? found->second.index : 0;
+        }
+
+        updateTextureDescriptor(logical_device, descriptor_set, binding, texture, slot);
+
+        if (found != slots.end())
+        {
+            retire(found->second.index);
+            found->second = { slot, texture.generation };
+        }
+        else
+            slots.emplace(&texture, Slot{ slot, texture.generation });
+
+        return slot;
+    }
+
+    void TextureTable::remove(const Texture& texture)
+    {
+        auto found = slots.find(&texture);
+        if (found == slots.end())
+            return;
+
+        retire(found->second.index);
+        slots.erase(found);
+    }
+
+    void TextureTable::retire(uint32_t index)
+    {
+        retired.push_back({ index, frame });
+    }
+}
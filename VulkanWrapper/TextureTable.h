@@ -0,0 +1,62 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "DescriptorPool.h"
+#include "Shader.h"
+
+#include <unordered_map>
+#include <vector>
+
+namespace VulkanWrapper
+{
+    struct Texture;
+
+    // One global, partially bound array of combined image samplers that shaders index with a per-draw texture index.
+    // Slots are written with update after bind and unused while pending, so new slots can be filled while earlier
+    // frames are still in flight. A slot that may still be sampled is never rewritten: a texture whose image changed
+    // (see Texture::generation) gets a fresh slot, and the old one is reused once frames_in_flight frames have passed.
+    struct TextureTable
+    {
+        static constexpr uint32_t binding = 0;
+
+        VkDescriptorSet descriptor_set = VK_NULL_HANDLE;
+        uint32_t capacity = 0;
+
+        struct Slot
+        {
+            uint32_t index;
+            uint32_t generation;
+        };
+        std::unordered_map<const Texture*, Slot> slots;
+
+        struct RetiredSlot
+        {
+            uint32_t index;
+            uint64_t frame;
+        };
+        std::vector<RetiredSlot> retired;
+        std::vector<uint32_t> free_slots;
+        uint32_t next_slot = 0;
+
+        uint64_t frame = 0;
+        uint32_t frames_in_flight = 2;
+
+        // layout's first binding must be a combined image sampler array, its descriptor_count is the table's capacity
+        void init(VkDevice logical_device, DescriptorPool& descriptor_pool, const DescriptorSetLayout& layout, uint32_t frames_in_flight);
+        void deinit();
+
+        // once per frame, after the frame's fence has been waited on
+        void beginFrame();
+
+        // the slot of the texture's current image, written on first use and whenever the image was replaced
+        uint32_t index(VkDevice logical_device, const Texture& texture);
+
+        // drops the texture's slot, call before the texture is destroyed
+        void remove(const Texture& texture);
+
+    private:
+        void retire(uint32_t index);
+    };
+}
@@ -0,0 +1,54 @@
+#include "UniformRing.h"
+#include "Log.h"
+
+namespace VulkanWrapper
+{
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    void UniformRing::init(DeviceManager& device_manager, const uint32_t slice_count, const VkDeviceSize slice_size)
+    {
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(device_manager.physicalDevice, &properties);
+        alignment = properties.limits.minUniformBufferOffsetAlignment;
+
+        this->slice_count = slice_count;
+        this->slice_size = alignUp(slice_size, alignment);
+
+        buffer.init(device_manager, this->slice_size * slice_count, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        buffer.count = 1;
+
+        current_slice = 0;
+        head = 0;
+    }
+
+    void UniformRing::deinit(DeviceManager& device_manager)
+    {
+        buffer.deinit(device_manager);
+    }
+
+    void UniformRing::beginFrame(const uint32_t slice_index)
+    {
+        if (slice_index >= slice_count)
+            log_error("UniformRing slice index out of range!");
+
+        current_slice = slice_index;
+        head = 0;
+    }
+
+    UniformAllocation UniformRing::allocate(const VkDeviceSize size)
+    {
+        if (head + size > slice_size)
+            log_error("UniformRing slice exhausted, increase the slice size!");
+
+        const VkDeviceSize offset = sliceOffset(current_slice) + head;
+        head = alignUp(head + size, alignment);
+
+        UniformAllocation allocation{};
+        allocation.offset = static_cast<uint32_t>(offset);
+        allocation.data = static_cast<char*>(buffer.allocation.mapped) + offset;
+        return allocation;
+    }
+}
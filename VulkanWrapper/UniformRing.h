@@ -0,0 +1,51 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "Buffer.h"
+#include "DeviceManager.h"
+
+#include <cstring>
+
+namespace VulkanWrapper
+{
+    struct UniformAllocation
+    {
+        uint32_t offset; // dynamic offset to pass to vkCmdBindDescriptorSets
+        void* data;
+    };
+
+    // One persistently mapped, host coherent uniform buffer split into a slice per frame.
+    // Each frame bump allocates aligned sub-ranges out of its own slice, which are bound through
+    // VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC descriptors pointing at the start of the buffer.
+    struct UniformRing
+    {
+        Buffer buffer;
+
+        VkDeviceSize alignment;
+        VkDeviceSize slice_size;
+        uint32_t slice_count;
+
+        uint32_t current_slice = 0;
+        VkDeviceSize head = 0;
+
+        void init(DeviceManager& device_manager, const uint32_t slice_count, const VkDeviceSize slice_size);
+        void deinit(DeviceManager& device_manager);
+
+        // the caller must guarantee the GPU is no longer reading the slice, e.g. by waiting on the frame fence
+        void beginFrame(const uint32_t slice_index);
+
+        UniformAllocation allocate(const VkDeviceSize size);
+
+        VkDeviceSize sliceOffset(const uint32_t slice_index) const { return slice_index * slice_size; }
+
+        template<typename T>
+        uint32_t push(const T& data)
+        {
+            UniformAllocation allocation = allocate(sizeof(T));
+            memcpy(allocation.data, &data, sizeof(T));
+            return allocation.offset;
+        }
+    };
+}
@@ -0,0 +1,287 @@
+#include "UploadBatch.h"
+#include "Log.h"
+
+#include <cstring>
+#include <algorithm>
+
+namespace VulkanWrapper
+{
+    static constexpr VkPipelineStageFlags consumer_stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    static constexpr VkAccessFlags consumer_access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    static VkCommandBuffer beginCommandBuffer(VkDevice logical_device, VkCommandPool command_pool)
+    {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = command_pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+
+        VkCommandBuffer command_buffer;
+        if (vkAllocateCommandBuffers(logical_device, &allocInfo, &command_buffer) != VK_SUCCESS)
+            log_error("failed to allocate upload command buffer!");
+
+        VkCommandBufferBeginInfo beginInfo{};
+        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        if (vkBeginCommandBuffer(command_buffer, &beginInfo) != VK_SUCCESS)
+            log_error("failed to begin recording upload command buffer!");
+
+        return command_buffer;
+    }
+
+    static VkFence createFence(VkDevice logical_device)
+    {
+        VkFenceCreateInfo fenceInfo{};
+        fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+        VkFence fence;
+        if (vkCreateFence(logical_device, &fenceInfo, nullptr, &fence) != VK_SUCCESS)
+            log_error("failed to create upload fence!");
+
+        return fence;
+    }
+
+    void UploadBatch::begin(DeviceManager& device_manager)
+    {
+        this->device_manager = &device_manager;
+        submitted = false;
+        ownership_transfer = device_manager.transferQueueFamily != device_manager.graphicsQueueFamily;
+
+        VkPhysicalDeviceProperties properties{};
+        vkGetPhysicalDeviceProperties(device_manager.physicalDevice, &properties);
+        // 16 covers the texel block size of every format we upload
+        copy_alignment = std::max<VkDeviceSize>(16, properties.limits.optimalBufferCopyOffsetAlignment);
+
+        command_buffer = beginCommandBuffer(device_manager.logicalDevice, device_manager.transfer_command_pool);
+
+        if (ownership_transfer)
+            acquire_command_buffer = beginCommandBuffer(device_manager.logicalDevice, device_manager.command_pool);
+    }
+
+    StagingAllocation UploadBatch::stage(const void* data, const VkDeviceSize size)
+    {
+        if (submitted)
+            log_error("UploadBatch already submitted!");
+
+        auto fits = [&](const StagingChunk& chunk)
+        {
+            const VkDeviceSize offset = (chunk.head + copy_alignment - 1) / copy_alignment * copy_alignment;
+            return offset + size <= chunk.size;
+        };
+
+        if (chunks.empty() || !fits(chunks.back()))
+            chunks.push_back(device_manager->staging_arena.acquireChunk(device_manager->logicalDevice, device_manager->allocator, size));
+
+        StagingChunk& chunk = chunks.back();
+        const VkDeviceSize offset = (chunk.head + copy_alignment - 1) / copy_alignment * copy_alignment;
+        chunk.head = offset + size;
+
+        StagingAllocation allocation{};
+        allocation.buffer = chunk.buffer;
+        allocation.offset = offset;
+        allocation.data = static_cast<char*>(chunk.allocation.mapped) + offset;
+
+        if (data)
+            memcpy(allocation.data, data, (size_t)size);
+
+        return allocation;
+    }
+
+    void UploadBatch::uploadBuffer(Buffer& buffer, const void* data, const VkDeviceSize size, const VkDeviceSize dst_offset)
+    {
+        StagingAllocation staging = stage(data, size);
+
+        VkBufferCopy copyRegion{};
+        copyRegion.srcOffset = staging.offset;
+        copyRegion.dstOffset = dst_offset;
+        copyRegion.size = size;
+        vkCmdCopyBuffer(command_buffer, staging.buffer, buffer.handle, 1, &copyRegion);
+
+        // without an ownership transfer a single global memory barrier covers all buffers
+        if (ownership_transfer)
+        {
+            VkBufferMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = device_manager->transferQueueFamily;
+            barrier.dstQueueFamilyIndex = device_manager->graphicsQueueFamily;
+            barrier.buffer = buffer.handle;
+            barrier.offset = dst_offset;
+            barrier.size = size;
+            buffer_barriers.push_back(barrier);
+        }
+    }
+
+    void UploadBatch::uploadImage(Image& image, const TextureData::Level* levels, const uint32_t level_count)
+    {
+        // one staging allocation for all levels, level sizes are multiples of the texel block size so every copy stays aligned
+        VkDeviceSize size = 0;
+        for (uint32_t level = 0; level < level_count; ++level)
+            size += levels[level].size;
+
+        StagingAllocation staging = stage(nullptr, size);
+
+        transitionLayout(command_buffer, image, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+        VkDeviceSize offset = 0;
+        for (uint32_t level = 0; level < level_count; ++level)
+        {
+            memcpy(static_cast<char*>(staging.data) + offset, levels[level].data, (size_t)levels[level].size);
+            copyBufferToImage(command_buffer, staging.buffer, staging.offset + offset, image, level);
+            offset += levels[level].size;
+        }
+
+        const bool generate_mips = level_count < image.mip_map_levels;
+        if (generate_mips)
+            mip_generation.push_back({ &image, level_count });
+
+        // images that still need blits stay transfer destinations until they are done, see submit
+        if (generate_mips && !ownership_transfer)
+            return;
+
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = generate_mips ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcQueueFamilyIndex = ownership_transfer ? device_manager->transferQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = ownership_transfer ? device_manager->graphicsQueueFamily : VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = image.handle;
+        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = image.mip_map_levels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        image_barriers.push_back(barrier);
+    }
+
+    void UploadBatch::onComplete(std::function<void()> callback)
+    {
+        on_complete.push_back(std::move(callback));
+    }
+
+    UploadToken UploadBatch::submit()
+    {
+        if (submitted)
+            log_error("UploadBatch already submitted!");
+
+        PendingUpload upload;
+        upload.transfer_command_buffer = command_buffer;
+        upload.transfer_fence = createFence(device_manager->logicalDevice);
+
+        if (!ownership_transfer)
+        {
+            // the transfer family is the graphics family here, so the blits go straight into this command buffer
+            for (const auto& generation : mip_generation)
+                generateMipMaps(command_buffer, *generation.image, generation.first_level);
+
+            // make the copies visible to the draws submitted after this batch
+            VkMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask = consumer_access;
+
+            for (auto& image_barrier : image_barriers)
+            {
+                image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                image_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            }
+
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, consumer_stages, 0, 1, &barrier, 0, nullptr, (uint32_t)image_barriers.size(), image_barriers.data());
+        }
+        else
+        {
+            // release on the transfer queue, the stages after the copy are meaningless there
+            for (auto& buffer_barrier : buffer_barriers)
+            {
+                buffer_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                buffer_barrier.dstAccessMask = 0;
+            }
+            for (auto& image_barrier : image_barriers)
+            {
+                image_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+                image_barrier.dstAccessMask = 0;
+            }
+
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                (uint32_t)buffer_barriers.size(), buffer_barriers.data(), (uint32_t)image_barriers.size(), image_barriers.data());
+
+            // matching acquire on the graphics queue
+            for (auto& buffer_barrier : buffer_barriers)
+            {
+                buffer_barrier.srcAccessMask = 0;
+                buffer_barrier.dstAccessMask = consumer_access;
+            }
+            // images still needing mips are acquired for the blits instead, which need the graphics queue
+            std::vector<VkImageMemoryBarrier> blit_barriers;
+            for (size_t i = 0; i < image_barriers.size();)
+            {
+                if (image_barriers[i].newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL)
+                {
+                    blit_barriers.push_back(image_barriers[i]);
+                    blit_barriers.back().srcAccessMask = 0;
+                    blit_barriers.back().dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+                    image_barriers.erase(image_barriers.begin() + i);
+                    continue;
+                }
+
+                image_barriers[i].srcAccessMask = 0;
+                image_barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+                ++i;
+            }
+
+            vkCmdPipelineBarrier(acquire_command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, consumer_stages, 0, 0, nullptr,
+                (uint32_t)buffer_barriers.size(), buffer_barriers.data(), (uint32_t)image_barriers.size(), image_barriers.data());
+
+            if (!blit_barriers.empty())
+            {
+                vkCmdPipelineBarrier(acquire_command_buffer, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr,
+                    0, nullptr, (uint32_t)blit_barriers.size(), blit_barriers.data());
+
+                for (const auto& generation : mip_generation)
+                    generateMipMaps(acquire_command_buffer, *generation.image, generation.first_level);
+            }
+
+            if (vkEndCommandBuffer(acquire_command_buffer) != VK_SUCCESS)
+                log_error("failed to record upload acquire command buffer!");
+
+            VkSemaphoreCreateInfo semaphoreInfo{};
+            semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+            if (vkCreateSemaphore(device_manager->logicalDevice, &semaphoreInfo, nullptr, &upload.transfer_finished) != VK_SUCCESS)
+                log_error("failed to create upload semaphore!");
+
+            upload.acquire_command_buffer = acquire_command_buffer;
+            upload.acquire_fence = createFence(device_manager->logicalDevice);
+        }
+
+        if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS)
+            log_error("failed to record upload command buffer!");
+
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers = &command_buffer;
+        if (ownership_transfer)
+        {
+            submitInfo.signalSemaphoreCount = 1;
+            submitInfo.pSignalSemaphores = &upload.transfer_finished;
+        }
+
+        if (vkQueueSubmit(device_manager->transferQueue, 1, &submitInfo, upload.transfer_fence) != VK_SUCCESS)
+            log_error("failed to submit upload command buffer!");
+
+        upload.chunks = std::move(chunks);
+        upload.on_complete = std::move(on_complete);
+
+        command_buffer = VK_NULL_HANDLE;
+        acquire_command_buffer = VK_NULL_HANDLE;
+        buffer_barriers.clear();
+        image_barriers.clear();
+        mip_generation.clear();
+        chunks.clear();
+        on_complete.clear();
+        submitted = true;
+
+        return device_manager->upload_queue.push(std::move(upload));
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "Buffer.h"
+#include "Image.h"
+#include "DeviceManager.h"
+#include "StagingArena.h"
+#include "UploadQueue.h"
+
+#include <vector>
+#include <functional>
+
+namespace VulkanWrapper
+{
+    // Records every staging copy and layout transition for a group of resources into a single
+    // command buffer on the transfer queue. submit() hands the batch to the DeviceManager's UploadQueue
+    // and returns a token which completes once the resources are usable on the graphics queue.
+    struct UploadBatch
+    {
+        DeviceManager* device_manager = nullptr;
+
+        VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+        VkCommandBuffer acquire_command_buffer = VK_NULL_HANDLE; // only used when the transfer family differs from graphics
+        bool ownership_transfer = false;
+
+        // final barriers, recorded at submit: release/acquire pairs with a dedicated transfer queue,
+        // plain transfer -> shader read barriers otherwise
+        std::vector<VkBufferMemoryBarrier> buffer_barriers;
+        std::vector<VkImageMemoryBarrier> image_barriers;
+
+        // images whose remaining mip levels are blitted at submit, on the graphics side of the batch
+        struct MipGeneration
+        {
+            Image* image;
+            uint32_t first_level;
+        };
+        std::vector<MipGeneration> mip_generation;
+
+        std::vector<StagingChunk> chunks; // the last chunk is the one currently being filled
+        VkDeviceSize copy_alignment;
+
+        std::vector<std::function<void()>> on_complete;
+
+        bool submitted = false;
+
+        void begin(DeviceManager& device_manager);
+
+        StagingAllocation stage(const void* data, const VkDeviceSize size);
+
+        void uploadBuffer(Buffer& buffer, const void* data, const VkDeviceSize size, const VkDeviceSize dst_offset = 0);
+        // copies levels [0, level_count) into the image, any further levels of the image are generated with blits,
+        // so the format must support linear blit filtering if level_count < mip_map_levels
+        void uploadImage(Image& image, const TextureData::Level* levels, const uint32_t level_count = 1);
+
+        // called on the main thread once the GPU has finished with this batch
+        void onComplete(std::function<void()> callback);
+
+        UploadToken submit();
+    };
+
+    template<typename T>
+    void uploadBufferData(UploadBatch& batch, Buffer& buffer, const std::vector<T>& data, VkBufferUsageFlags usage)
+    {
+        const VkDeviceSize bufferSize = sizeof(data[0]) * data.size();
+
+        buffer.init(*batch.device_manager, bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        buffer.count = data.size();
+
+        batch.uploadBuffer(buffer, data.data(), bufferSize);
+    }
+}
@@ -0,0 +1,118 @@
+#include "UploadQueue.h"
+#include "DeviceManager.h"
+#include "Log.h"
+
+#include <algorithm>
+
+namespace VulkanWrapper
+{
+    static bool fenceSignalled(VkDevice logical_device, VkFence fence, bool block)
+    {
+        if (block)
+            return vkWaitForFences(logical_device, 1, &fence, VK_TRUE, UINT64_MAX) == VK_SUCCESS;
+
+        return vkGetFenceStatus(logical_device, fence) == VK_SUCCESS;
+    }
+
+    UploadToken UploadQueue::push(PendingUpload&& upload)
+    {
+        upload.id = next_id++;
+
+        UploadToken token;
+        token.id = upload.id;
+
+        pending.push_back(std::move(upload));
+        return token;
+    }
+
+    bool UploadQueue::advance(DeviceManager& device_manager, PendingUpload& upload, bool block)
+    {
+        if (upload.acquire_command_buffer != VK_NULL_HANDLE && !upload.acquire_submitted)
+        {
+            // the acquire is only submitted once the transfer is known to be done, so the graphics
+            // queue never stalls on the semaphore in front of frames that don't need the new data
+            if (!fenceSignalled(device_manager.logicalDevice, upload.transfer_fence, block))
+                return false;
+
+            VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+
+            VkSubmitInfo submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submitInfo.waitSemaphoreCount = 1;
+            submitInfo.pWaitSemaphores = &upload.transfer_finished;
+            submitInfo.pWaitDstStageMask = &wait_stage;
+            submitInfo.commandBufferCount = 1;
+            submitInfo.pCommandBuffers = &upload.acquire_command_buffer;
+
+            if (vkQueueSubmit(device_manager.graphicsQueue, 1, &submitInfo, upload.acquire_fence) != VK_SUCCESS)
+                log_error("failed to submit upload acquire command buffer!");
+
+            upload.acquire_submitted = true;
+        }
+
+        VkFence final_fence = upload.acquire_command_buffer != VK_NULL_HANDLE ? upload.acquire_fence : upload.transfer_fence;
+        if (!fenceSignalled(device_manager.logicalDevice, final_fence, block))
+            return false;
+
+        // retire
+        device_manager.staging_arena.releaseChunks(device_manager.logicalDevice, device_manager.allocator, upload.chunks);
+
+        vkFreeCommandBuffers(device_manager.logicalDevice, device_manager.transfer_command_pool, 1, &upload.transfer_command_buffer);
+        vkDestroyFence(device_manager.logicalDevice, upload.transfer_fence, nullptr);
+
+        if (upload.acquire_command_buffer != VK_NULL_HANDLE)
+        {
+            vkFreeCommandBuffers(device_manager.logicalDevice, device_manager.command_pool, 1, &upload.acquire_command_buffer);
+            vkDestroyFence(device_manager.logicalDevice, upload.acquire_fence, nullptr);
+            vkDestroySemaphore(device_manager.logicalDevice, upload.transfer_finished, nullptr);
+        }
+
+        for (auto& callback : upload.on_complete)
+            callback();
+
+        return true;
+    }
+
+    void UploadQueue::poll(DeviceManager& device_manager)
+    {
+        auto retired = std::remove_if(pending.begin(), pending.end(), [&](PendingUpload& upload) { return advance(device_manager, upload, false); });
+        pending.erase(retired, pending.end());
+    }
+
+    bool UploadQueue::isComplete(UploadToken token) const
+    {
+        for (const auto& upload : pending)
+        {
+            if (upload.id == token.id)
+                return false;
+        }
+
+        return true;
+    }
+
+    void UploadQueue::wait(DeviceManager& device_manager, UploadToken token)
+    {
+        for (size_t i = 0; i < pending.size(); ++i)
+        {
+            if (pending[i].id == token.id)
+            {
+                advance(device_manager, pending[i], true);
+                pending.erase(pending.begin() + i);
+                return;
+            }
+        }
+    }
+
+    void UploadQueue::waitAll(DeviceManager& device_manager)
+    {
+        for (auto& upload : pending)
+            advance(device_manager, upload, true);
+
+        pending.clear();
+    }
+
+    void UploadQueue::deinit(DeviceManager& device_manager)
+    {
+        waitAll(device_manager);
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+#include "StagingArena.h"
+
+#include <vector>
+#include <functional>
+
+namespace VulkanWrapper
+{
+    struct DeviceManager;
+
+    // Handle for a submitted UploadBatch, poll it with UploadQueue::isComplete
+    struct UploadToken
+    {
+        uint64_t id = 0;
+    };
+
+    struct PendingUpload
+    {
+        uint64_t id;
+
+        VkCommandBuffer transfer_command_buffer = VK_NULL_HANDLE;
+        VkFence transfer_fence = VK_NULL_HANDLE;
+
+        // graphics queue half of the queue family ownership transfer, only used with a dedicated transfer queue
+        VkCommandBuffer acquire_command_buffer = VK_NULL_HANDLE;
+        VkFence acquire_fence = VK_NULL_HANDLE;
+        VkSemaphore transfer_finished = VK_NULL_HANDLE;
+        bool acquire_submitted = false;
+
+        std::vector<StagingChunk> chunks;
+        std::vector<std::function<void()>> on_complete; // run once the GPU is done with the batch, e.g. deferred frees
+    };
+
+    // Tracks uploads in flight. poll() is called once per frame from the main loop; it hands finished
+    // transfers over to the graphics queue and retires batches whose GPU work has completed.
+    struct UploadQueue
+    {
+        uint64_t next_id = 1;
+        std::vector<PendingUpload> pending;
+
+        UploadToken push(PendingUpload&& upload);
+
+        void poll(DeviceManager& device_manager);
+        bool isComplete(UploadToken token) const;
+
+        void wait(DeviceManager& device_manager, UploadToken token);
+        void waitAll(DeviceManager& device_manager);
+
+        void deinit(DeviceManager& device_manager);
+
+    private:
+        bool advance(DeviceManager& device_manager, PendingUpload& upload, bool block);
+    };
+}